@@ -2,6 +2,7 @@
 #include <debug.h>
 #include "filesys/inode.h"
 #include "threads/malloc.h"
+#include "userprog/pipe.h"
 
 
 /* Opens a file for the given INODE, of which it takes ownership,
@@ -14,8 +15,7 @@ file_open (struct inode *inode) {
 		file->inode = inode;
 		file->pos = 0;
 		file->deny_write = false;
-		/* 파일 복제된 횟수 카운트 */
-		file->dupCount = 0;
+		file->ref_cnt = 1;
 
 		return file;
 	} else {
@@ -41,18 +41,44 @@ file_duplicate (struct file *file) {
 		nfile->pos = file->pos;
 		if (file->deny_write)
 			file_deny_write (nfile);
-		/* fork 됬다는건 새로울 파일을 reopen했으니까 각파일을 참조하고있는지 복사해줘야됨*/
-		nfile->dupCount = file->dupCount;
 	}
 	return nfile;
 }
 
-/* Closes FILE. */
+/* Opens and returns a new file for the reading end of PIPE, or for
+ * its writing end if WRITER.  Closing the file closes that end.
+ * Returns a null pointer if an allocation fails. */
+struct file *
+file_open_pipe (struct pipe *pipe, bool writer) {
+	struct file *file = calloc (1, sizeof *file);
+	if (file != NULL) {
+		file->pipe = pipe;
+		file->pipe_writer = writer;
+		file->ref_cnt = 1;
+	}
+	return file;
+}
+
+/* Adds a reference to FILE and returns it.  The position and the
+ * write denial are shared with every other holder of FILE, as with
+ * descriptors copied by dup2() or inherited across fork(). */
+struct file *
+file_dup (struct file *file) {
+	__atomic_add_fetch (&file->ref_cnt, 1, __ATOMIC_RELAXED);
+	return file;
+}
+
+/* Drops a reference to FILE and closes it once none are left. */
 void
 file_close (struct file *file) {
-	if (file != NULL) {
-		file_allow_write (file);
-		inode_close (file->inode);
+	if (file != NULL
+			&& __atomic_sub_fetch (&file->ref_cnt, 1, __ATOMIC_ACQ_REL) == 0) {
+		if (file->pipe != NULL)
+			pipe_close (file->pipe, file->pipe_writer);
+		else {
+			file_allow_write (file);
+			inode_close (file->inode);
+		}
 		free (file);
 	}
 }
@@ -6,6 +6,9 @@
 #include "filesys/filesys.h"
 #include "filesys/free-map.h"
 #include "threads/malloc.h"
+#ifdef VM
+#include "vm/fcache.h"
+#endif
 
 /* Identifies an inode. */
 #define INODE_MAGIC 0x494e4f44
@@ -33,6 +36,7 @@ struct inode {
 	int open_cnt;                       /* Number of openers. */
 	bool removed;                       /* True if deleted, false otherwise. */
 	int deny_write_cnt;                 /* 0: writes ok, >0: deny writes. */
+	bool cached;                        /* Pages may be in the frame cache. */
 	struct inode_disk data;             /* Inode content. */
 };
 
@@ -125,6 +129,7 @@ inode_open (disk_sector_t sector) {
 	inode->open_cnt = 1;
 	inode->deny_write_cnt = 0;
 	inode->removed = false;
+	inode->cached = false;
 	disk_read (filesys_disk, inode->sector, &inode->data);
 	return inode;
 }
@@ -284,6 +289,11 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
 	}
 	free (bounce);
 
+#ifdef VM
+	/* Cached executable pages of this file are stale now. */
+	if (bytes_written > 0 && inode->cached)
+		fcache_invalidate (inode);
+#endif
 	return bytes_written;
 }
 
@@ -306,6 +316,13 @@ inode_allow_write (struct inode *inode) {
 	inode->deny_write_cnt--;
 }
 
+/* Notes that pages of INODE may get into the frame cache, so that
+   writes to it invalidate them from now on. */
+void
+inode_set_cached (struct inode *inode) {
+	inode->cached = true;
+}
+
 /* Returns the length, in bytes, of INODE's data. */
 off_t
 inode_length (const struct inode *inode) {
@@ -9,14 +9,19 @@ struct file {
 	struct inode *inode;        /* File's inode. */
 	off_t pos;                  /* Current position. */
 	bool deny_write;            /* Has file_deny_write() been called? */
-	int dupCount;
+	int ref_cnt;                /* Descriptors sharing this file. */
+	struct pipe *pipe;          /* Pipe this is an end of, or NULL. */
+	bool pipe_writer;           /* Writing end of PIPE? */
 };
 struct inode;
+struct pipe;
 
 /* Opening and closing files. */
 struct file *file_open (struct inode *);
 struct file *file_reopen (struct file *);
 struct file *file_duplicate (struct file *file);
+struct file *file_dup (struct file *);
+struct file *file_open_pipe (struct pipe *, bool writer);
 void file_close (struct file *);
 struct inode *file_get_inode (struct file *);
 
@@ -36,6 +36,23 @@ enum {
 
 	SYS_MOUNT,
 	SYS_UMOUNT,
+
+	/* Extra for Project 3 */
+	SYS_MSYNC,                  /* Write back a memory mapping. */
+	SYS_MADVISE,                /* Give advice about memory use. */
+	SYS_SETRLIMIT,              /* Set a resource limit. */
+	SYS_GETRLIMIT,              /* Get a resource limit. */
+	SYS_GETRUSAGE,              /* Get paging statistics. */
+	SYS_PREAD,                  /* Read from a file at an offset. */
+	SYS_PWRITE,                 /* Write to a file at an offset. */
+	SYS_READV,                  /* Read into several buffers. */
+	SYS_WRITEV,                 /* Write from several buffers. */
+	SYS_COPY_FILE_RANGE,        /* Copy data between two files. */
+	SYS_IORING_SETUP,           /* Map an asynchronous I/O ring. */
+	SYS_IORING_ENTER,           /* Submit to and wait on the ring. */
+	SYS_SPAWN,                  /* Start a program in a new process. */
+	SYS_PIPE,                   /* Create a pipe. */
+	SYS_WAITPID,                /* Wait for a child, maybe without blocking. */
 };
 
 #endif /* lib/syscall-nr.h */
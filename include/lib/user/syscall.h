@@ -4,6 +4,7 @@
 #include <stdbool.h>
 #include <debug.h>
 #include <stddef.h>
+#include <stdint.h>
 
 /* Process identifier. */
 typedef int pid_t;
@@ -13,6 +14,115 @@ typedef int pid_t;
 typedef int off_t;
 #define MAP_FAILED ((void *) NULL)
 
+/* mmap() FD for anonymous memory shared with forked children. */
+#define MAP_ANONYMOUS (-1)
+
+/* msync() flags. */
+#define MS_ASYNC 1              /* Schedule the writeback and return. */
+#define MS_INVALIDATE 2         /* Accepted and ignored. */
+#define MS_SYNC 4               /* Write back before returning. */
+
+/* madvise() advice. */
+#define MADV_NORMAL 0           /* No special treatment. */
+#define MADV_RANDOM 1           /* Expect random access. */
+#define MADV_SEQUENTIAL 2       /* Expect sequential access. */
+#define MADV_WILLNEED 3         /* Expect access soon. */
+#define MADV_DONTNEED 4         /* Contents no longer needed. */
+
+/* Resources for setrlimit() and getrlimit(). */
+#define RLIMIT_STACK 0          /* Maximum stack size, in bytes. */
+#define RLIMIT_RSS 1            /* Maximum resident memory, in bytes. */
+#define RLIMIT_RSS_MIN 2        /* Resident memory kept from other
+                                   processes, in bytes. */
+
+/* Paging activity of the calling process, filled in by getrusage(). */
+struct rusage {
+	long minflt;            /* Faults served without reading the disk. */
+	long majflt;            /* Faults that read from the disk. */
+	long fileflt;           /* Faults on mmap'd pages. */
+	long stackflt;          /* Faults that grew the stack. */
+	long swapin;            /* Pages read back from swap. */
+	long swapout;           /* Pages written to swap. */
+	long inblock;           /* Pages read from files or swap. */
+	long oublock;           /* Pages written back to files or swap. */
+	long fault_cycles;      /* CPU cycles spent handling faults. */
+	long rss;               /* Pages resident now. */
+	long swap;              /* Pages in swap now. */
+};
+
+/* A buffer for readv() and writev(). */
+struct iovec {
+	void *iov_base;         /* Start of the buffer. */
+	size_t iov_len;         /* Its length in bytes. */
+};
+
+/* Most buffers readv() and writev() take at once. */
+#define IOV_MAX 64
+
+/* Operations of an I/O ring request. */
+#define IORING_OP_NOP 0         /* Does nothing. */
+#define IORING_OP_READ 1        /* Reads like pread(). */
+#define IORING_OP_WRITE 2       /* Writes like pwrite(). */
+#define IORING_OP_FSYNC 3       /* Waits until FD's writes are on disk. */
+#define IORING_OP_OPEN 4        /* Opens the file named by BUF. */
+
+/* Most entries a submission queue may have. */
+#define IORING_ENTRIES_MAX 256
+
+/* A request in the submission queue of an I/O ring. */
+struct io_sqe {
+	uint8_t opcode;         /* One of IORING_OP_*. */
+	uint8_t pad[3];
+	int fd;
+	unsigned len;
+	off_t offset;
+	void *buf;              /* Data, or file name for IORING_OP_OPEN. */
+	uint64_t user_data;     /* Handed back in the completion. */
+};
+
+/* A completion in the completion queue of an I/O ring. */
+struct io_cqe {
+	uint64_t user_data;
+	int res;                /* What the call would return, -1 on failure. */
+	unsigned pad;
+};
+
+/* Head of an I/O ring, set up by ioring_setup(). Requests go in at
+ * SQES[SQ_TAIL & SQ_MASK] and completions come out at
+ * CQES[CQ_HEAD & CQ_MASK]; the process advances SQ_TAIL and CQ_HEAD,
+ * the kernel the other two. */
+struct io_ring {
+	unsigned sq_head, sq_tail, sq_mask, sq_entries;
+	unsigned cq_head, cq_tail, cq_mask, cq_entries;
+	struct io_sqe *sqes;
+	struct io_cqe *cqes;
+	uint64_t pad[2];
+};
+
+/* Bytes from ADDR on that ioring_setup() maps for ENTRIES entries. */
+#define IORING_SIZE(ENTRIES) \
+	(sizeof (struct io_ring) + (ENTRIES) * sizeof (struct io_sqe) \
+	 + 2 * (ENTRIES) * sizeof (struct io_cqe))
+
+/* Changes spawn() makes to the descriptors the new process inherits,
+ * in order. A list of them ends with SPAWN_END. */
+#define SPAWN_END 0             /* Ends the list. */
+#define SPAWN_CLOSE 1           /* Close FD. */
+#define SPAWN_DUP2 2            /* Make NEWFD refer to what FD does. */
+
+struct spawn_action {
+	int op;
+	int fd;
+	int newfd;
+};
+
+/* Most arguments and descriptor changes spawn() takes. */
+#define SPAWN_ARGS_MAX 63
+#define SPAWN_ACTIONS_MAX 16
+
+/* waitpid() options. */
+#define WNOHANG 1               /* Return 0 instead of waiting. */
+
 /* Maximum characters in a filename written by readdir(). */
 #define READDIR_MAX_LEN 14
 
@@ -41,6 +151,23 @@ int dup2(int oldfd, int newfd);
 /* Project 3 and optionally project 4. */
 void *mmap (void *addr, size_t length, int writable, int fd, off_t offset);
 void munmap (void *addr);
+int msync (void *addr, size_t length, int flags);
+int madvise (void *addr, size_t length, int advice);
+bool setrlimit (int resource, size_t limit);
+size_t getrlimit (int resource);
+int getrusage (struct rusage *usage);
+int pread (int fd, void *buffer, unsigned length, off_t offset);
+int pwrite (int fd, const void *buffer, unsigned length, off_t offset);
+int readv (int fd, const struct iovec *iov, int iovcnt);
+int writev (int fd, const struct iovec *iov, int iovcnt);
+int copy_file_range (int in_fd, off_t in_off, int out_fd, off_t out_off,
+                     unsigned length);
+struct io_ring *ioring_setup (void *addr, unsigned entries);
+int ioring_enter (unsigned to_submit, unsigned min_complete);
+pid_t spawn (const char *path, char *const argv[],
+             const struct spawn_action *fd_actions);
+int pipe (int fds[2]);
+pid_t waitpid (pid_t pid, int *status, int options);
 
 /* Project 4 only. */
 bool chdir (const char *dir);
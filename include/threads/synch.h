@@ -41,6 +41,25 @@ void cond_wait(struct condition *, struct lock *);
 void cond_signal(struct condition *, struct lock *);
 void cond_broadcast(struct condition *, struct lock *);
 
+/* Readers-writer lock. Any number of readers or a single writer
+   may hold it. Waiting writers keep new readers out. */
+struct rwlock
+{
+	struct lock lock;			  /* Protects the members below. */
+	struct condition readers_ok;  /* Signaled when readers may enter. */
+	struct condition writers_ok;  /* Signaled when a writer may enter. */
+	int readers;				  /* Number of readers holding it. */
+	int writers_waiting;		  /* Number of writers waiting for it. */
+	struct thread *writer;		  /* Writer holding it, or NULL. */
+};
+
+void rwlock_init(struct rwlock *);
+void rwlock_acquire_read(struct rwlock *);
+bool rwlock_try_acquire_read(struct rwlock *);
+void rwlock_release_read(struct rwlock *);
+void rwlock_acquire_write(struct rwlock *);
+void rwlock_release_write(struct rwlock *);
+
 /* Optimization barrier.
  *
  * The compiler will not reorder operations across an
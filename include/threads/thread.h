@@ -7,6 +7,8 @@
 #include "threads/synch.h"
 #include "threads/interrupt.h"
 #include "threads/synch.h"
+#include "userprog/child.h"
+#include "userprog/fdtable.h"
 #ifdef VM
 #include "vm/vm.h"
 #endif
@@ -110,18 +112,14 @@ struct thread
 
 	/* Project 2 */
 	// 2-3 Parent-child hierarchy
-	struct list child_list;		 // keep children
-	struct list_elem child_elem; // used to put current thread into 'children' list
+	struct child_table children; // exit records of children, see userprog/child.c
+	struct child *exit_rec;		 // the parent's record of this process, NULL for kernel threads
 	// 2-3 wait syscall
-	struct semaphore wait_sema; // used by parent to wait for child
 	int exit_status;			// used to deliver child exit_status to parent
 	// 2-3 fork syscall
 	struct intr_frame parent_if; // to preserve my current intr_frame and pass it down to child in fork ('parent_if' in child's perspective)
-	struct semaphore fork_sema;	 // parent wait (process_wait) until child fork completes (__do_fork)
-	struct semaphore free_sema;	 // Postpone child termination (process_exit) until parent receives its exit_status in 'wait' (process_wait)
 	// 2-4 file descripter
-	struct file **fdTable; // allocation in threac_create (thread.c)
-	int fdIdx;			   // an index of an open spot in fdTable
+	struct fd_table fdTable; // grows as needed, see userprog/fdtable.c
 	// 2-5 deny exec writes
 	struct file *running; // executable ran by current process (process.c load, process_exit)
 	// 2-extra - count the number of open stdin/stdout
@@ -138,12 +136,24 @@ struct thread
 #ifdef USERPROG
 	/* Owned by userprog/process.c. */
 	uint64_t *pml4; /* Page map level 4 */
+	struct syscall_trace *trace; /* Recent system calls, see "-strace". */
+	struct ioring *ioring;  /* Asynchronous I/O ring, see ioring_setup(). */
 #endif
 #ifdef VM
 	/* Table for whole virtual memory owned by thread. */
 	struct supplemental_page_table spt; //! vm is in spt
 	void* stack_bottom;
 	uintptr_t saved_sp;
+	size_t stack_limit;    /* Bytes the stack may grow to, see setrlimit(). */
+	struct rusage rusage;  /* Paging counters, see getrusage(). */
+
+	/* Resident frames, on a clock of their own. The limit and the
+	 * guarantee are in pages, 0 for none. */
+	struct list frames;
+	struct list_elem *clock_hand;
+	size_t frame_cnt;
+	size_t rss_limit;
+	size_t rss_min;
 #endif
 
 	/* Owned by thread.c. */
@@ -206,12 +216,4 @@ void total_update_priority();
 void thread_update_priority(struct thread *t);
 int load_avg;
 
-// 2-4 syscall - fork
-#define FDT_PAGES 3					  // pages to allocate for file descriptor tables (thread_create, process_exit)
-#define FDCOUNT_LIMIT FDT_PAGES *(1 << 9) // Limit fdIdx
-
-/* file descriptor define */
-#define FDT_PAGES 3
-#define FDCOUNT_LIMIT FDT_PAGES *(1 << 9)
-
 #endif
\ No newline at end of file
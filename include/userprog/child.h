@@ -0,0 +1,42 @@
+#ifndef USERPROG_CHILD_H
+#define USERPROG_CHILD_H
+#include <hash.h>
+#include <list.h>
+#include <stdbool.h>
+#include "threads/synch.h"
+
+/* waitpid() options. */
+#define WNOHANG 1               /* Return 0 instead of waiting. */
+
+/* What a parent keeps of a child. It outlives the child's thread, so
+ * that a child gives back everything else as soon as it exits, and the
+ * parent collects the status whenever it waits. */
+struct child {
+	int tid;
+	int status;                 /* Exit status, once EXITED. */
+	bool exited;
+	bool start_failed;          /* fork() or spawn() could not build it. */
+	struct semaphore started;   /* Upped once built, see child_started(). */
+	struct child_table *table;  /* Parent's, NULL once the parent is gone. */
+	struct hash_elem elem;      /* In TABLE's children. */
+	struct list_elem exit_elem; /* In TABLE's exited, until waited for. */
+};
+
+/* Children of a process, by tid. */
+struct child_table {
+	struct hash children;
+	struct list exited;         /* Exited and not waited for, oldest first. */
+	struct condition child_exited;
+};
+
+void child_init (void);
+bool child_table_init (struct child_table *);
+void child_table_destroy (struct child_table *);
+struct child *child_create (struct child_table *);
+void child_add (struct child *, int tid);
+void child_discard (struct child *);
+void child_started (struct child *, bool success);
+void child_exit (struct child *, int status);
+int child_wait (struct child_table *, int tid, int *status, int options);
+
+#endif /* userprog/child.h */
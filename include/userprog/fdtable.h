@@ -0,0 +1,37 @@
+#ifndef USERPROG_FDTABLE_H
+#define USERPROG_FDTABLE_H
+#include <stdbool.h>
+#include <stdint.h>
+
+struct file;
+
+/* Most descriptors a process may have open. */
+#define FDCOUNT_LIMIT 1536
+
+/* Slots kept in the thread itself; more are allocated on demand. */
+#define FD_INLINE 8
+
+#define FD_WORDS (FDCOUNT_LIMIT / 64)
+
+/* File descriptor table of a process. Slot FD holds the file FD refers
+ * to, or the console sentinels 1 and 2. A bit per slot tells whether it
+ * is in use and a bit per word of those tells whether the word is full,
+ * so the lowest free descriptor is found with two bit scans. */
+struct fd_table {
+	struct file **files;        /* CAP slots, FILES_INLINE at first. */
+	int cap;
+	uint64_t full;              /* Bit W set if USED[W] is all ones. */
+	uint64_t used[FD_WORDS];    /* Bit FD set if slot FD is in use. */
+	struct file *files_inline[FD_INLINE];
+};
+
+void fd_table_init (struct fd_table *);
+void fd_table_destroy (struct fd_table *);
+struct file *fd_table_get (const struct fd_table *, int fd);
+bool fd_table_install (struct fd_table *, int fd, struct file *);
+int fd_table_alloc (struct fd_table *, struct file *);
+void fd_table_clear (struct fd_table *, int fd);
+int fd_table_next (const struct fd_table *, int fd);
+bool fd_table_full (const struct fd_table *);
+
+#endif /* userprog/fdtable.h */
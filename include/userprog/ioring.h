@@ -0,0 +1,60 @@
+#ifndef USERPROG_IORING_H
+#define USERPROG_IORING_H
+#include <stdint.h>
+#include "filesys/off_t.h"
+
+/* Operations of a submission queue entry. */
+#define IORING_OP_NOP 0         /* Completes with 0. */
+#define IORING_OP_READ 1        /* pread() into BUF. */
+#define IORING_OP_WRITE 2       /* pwrite() from BUF. */
+#define IORING_OP_FSYNC 3       /* Completes once FD's writes are on disk. */
+#define IORING_OP_OPEN 4        /* open() of the file named by BUF. */
+
+/* Most entries a submission queue may have. */
+#define IORING_ENTRIES_MAX 256
+
+/* Largest transfer of one read or write; longer ones come up short. */
+#define IORING_IO_MAX (16 * 4096)
+
+/* A request, as laid out in user memory. */
+struct io_sqe {
+	uint8_t opcode;
+	uint8_t pad[3];
+	int fd;
+	unsigned len;
+	off_t offset;
+	void *buf;
+	uint64_t user_data;     /* Handed back in the completion. */
+};
+
+/* A completion, as laid out in user memory. */
+struct io_cqe {
+	uint64_t user_data;
+	int res;                /* Result of the operation, -1 on failure. */
+	unsigned pad;
+};
+
+/* Head of a ring in user memory, followed by the submission queue and
+ * then the completion queue, which has twice as many entries. The
+ * process produces at SQ_TAIL and consumes at CQ_HEAD; the kernel owns
+ * the other two indexes. Indexes run freely and are masked on use. */
+struct io_ring {
+	unsigned sq_head, sq_tail, sq_mask, sq_entries;
+	unsigned cq_head, cq_tail, cq_mask, cq_entries;
+	struct io_sqe *sqes;
+	struct io_cqe *cqes;
+	uint64_t pad[2];
+};
+
+/* Bytes of user memory a ring of ENTRIES entries takes. */
+#define IORING_SIZE(ENTRIES) \
+	(sizeof (struct io_ring) + (ENTRIES) * sizeof (struct io_sqe) \
+	 + 2 * (ENTRIES) * sizeof (struct io_cqe))
+
+void ioring_init (void);
+void ioring_start (void);
+void *ioring_setup (void *addr, unsigned entries);
+int ioring_enter (unsigned to_submit, unsigned min_complete);
+void ioring_destroy (void);
+
+#endif /* userprog/ioring.h */
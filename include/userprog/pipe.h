@@ -0,0 +1,16 @@
+#ifndef USERPROG_PIPE_H
+#define USERPROG_PIPE_H
+#include <stdbool.h>
+
+struct file;
+struct pipe;
+
+/* Bytes a pipe buffers between its writer and its reader. */
+#define PIPE_SIZE 4096
+
+bool pipe_create (struct file **reader, struct file **writer);
+int pipe_read (struct pipe *, void *buffer, unsigned size);
+int pipe_write (struct pipe *, const void *buffer, unsigned size);
+void pipe_close (struct pipe *, bool writer);
+
+#endif /* userprog/pipe.h */
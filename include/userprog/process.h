@@ -3,28 +3,37 @@
 
 #include "threads/thread.h"
 
+/* Changes to the inherited descriptors of a spawned process. */
+#define SPAWN_END 0             /* Ends the list. */
+#define SPAWN_CLOSE 1           /* Close FD. */
+#define SPAWN_DUP2 2            /* Make NEWFD refer to what FD does. */
+
+/* A change to the inherited descriptors, see process_spawn(). */
+struct spawn_action {
+	int op;
+	int fd;
+	int newfd;
+};
+
+/* Most arguments and descriptor changes spawn() takes. */
+#define SPAWN_ARGS_MAX 63
+#define SPAWN_ACTIONS_MAX 16
+
 tid_t process_create_initd (const char *file_name);
 tid_t process_fork (const char *name, struct intr_frame *if_);
 int process_exec (void *f_name);
+tid_t process_spawn (const char *path, char **argv, int argc,
+		const struct spawn_action *actions, size_t action_cnt);
 int process_wait (tid_t);
+tid_t process_waitpid (tid_t, int *status, int options);
 void process_exit (void);
 void process_activate (struct thread *next);
 void argument_stack(char **argv, int argc, struct intr_frame *if_);
 
 bool install_page (void *upage, void *kpage, bool writable);
 
-struct thread *get_child_with_pid(int pid);
-
-
 bool install_page (void *upage, void *kpage, bool writable);
 bool setup_stack (struct intr_frame *if_);
 bool lazy_load_segment (struct page *page, void *aux);
 
-struct load_info{
-	struct file *file;
-	off_t ofs;
-	size_t page_read_bytes;
-	size_t page_zero_bytes;
-};
-
 #endif /* userprog/process.h */
@@ -5,7 +5,26 @@
 #include <stddef.h>
 
 void syscall_init (void);
+void syscall_print_stats (void);
+void syscall_exit_trace (void);
+
+struct file;
+int process_add_file (struct file *);
+struct file *process_get_file (int fd);
+struct file *get_seekable_file (int fd);
+
+/* Trace system calls of each process, set by "-strace". */
+extern bool syscall_trace;
 
 struct lock filesys_lock;
 
+/* A buffer for readv() and writev(), as laid out in user memory. */
+struct iovec {
+	void *iov_base;
+	size_t iov_len;
+};
+
+/* Most buffers readv() and writev() take at once. */
+#define IOV_MAX 64
+
 #endif /* userprog/syscall.h */
@@ -0,0 +1,12 @@
+#ifndef USERPROG_USERCOPY_H
+#define USERPROG_USERCOPY_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+size_t copy_from_user (void *dst, const void *usrc, size_t size);
+size_t copy_to_user (void *udst, const void *src, size_t size);
+int strncpy_from_user (char *dst, const char *usrc, size_t size);
+uintptr_t usercopy_fixup (uintptr_t rip);
+
+#endif /* userprog/usercopy.h */
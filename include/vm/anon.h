@@ -14,5 +14,9 @@ struct anon_page {
 
 void vm_anon_init (void);
 bool anon_initializer (struct page *page, enum vm_type type, void *kva);
+size_t anon_swap_free_cnt (void);
+size_t anon_swap_write (const void *kva);
+void anon_swap_read (size_t swap_slot_idx, void *kva);
+void anon_swap_discard (size_t swap_slot_idx);
 
 #endif
@@ -0,0 +1,46 @@
+#ifndef VM_FCACHE_H
+#define VM_FCACHE_H
+#include <list.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "filesys/off_t.h"
+
+struct inode;
+struct page;
+struct thread;
+struct vma;
+struct fcache_entry;
+
+/* Type marker of pages whose frame is owned by the frame cache. */
+#define VM_TEXT VM_MARKER_1
+
+/* A page of a read-only segment mapping a cached frame. Stays in place,
+ * with no frame, when the frame is reclaimed, and is mapped again from
+ * VMA on the next fault. */
+struct text_page {
+	struct vma *vma;            /* Segment the page belongs to. */
+	struct thread *owner;
+	struct list_elem elem;      /* In the mapper list of the entry. */
+};
+
+void fcache_init (void);
+struct fcache_entry *fcache_lookup (struct inode *inode, off_t ofs,
+		size_t read_bytes);
+struct fcache_entry *fcache_insert (struct inode *inode, off_t ofs,
+		size_t read_bytes, void *kva);
+void *fcache_kva (struct fcache_entry *entry);
+void fcache_release (struct fcache_entry *entry);
+void *fcache_reclaim (void);
+void fcache_invalidate (struct inode *inode);
+bool fcache_copy (struct inode *inode, off_t ofs, size_t read_bytes,
+		void *kva);
+void fcache_prefetch (struct inode *inode, off_t ofs, size_t read_bytes);
+void fcache_print_stats (void);
+
+bool fcache_map_page (struct page *page, struct fcache_entry *entry,
+		struct vma *vma);
+bool fcache_share_page (struct page *dst, struct page *src,
+		struct vma *vma);
+bool fcache_is_text (struct page *page);
+
+#endif /* vm/fcache.h */
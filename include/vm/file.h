@@ -12,6 +12,11 @@ struct file_page {
 	off_t ofs;
 };
 
+/* msync() flags. */
+#define MS_ASYNC 1              /* Leave the writeback to the flusher. */
+#define MS_INVALIDATE 2         /* Accepted and ignored. */
+#define MS_SYNC 4               /* Write back before returning. */
+
 struct mmap_info{
 	struct file* file;
 	off_t offset;
@@ -20,7 +25,11 @@ struct mmap_info{
 
 void vm_file_init (void);
 bool file_backed_initializer (struct page *page, enum vm_type type, void *kva);
+bool lazy_load_file (struct page *page, void *aux);
 void *do_mmap(void *addr, size_t length, int writable,
 		struct file *file, off_t offset);
-void do_munmap (void *va);
+bool do_munmap (void *va);
+bool do_munmap_range (void *start, void *end);
+bool do_msync (void *start, void *end, bool sync);
+void do_munmap_all (void);
 #endif
@@ -0,0 +1,37 @@
+#ifndef VM_SHMEM_H
+#define VM_SHMEM_H
+#include <list.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+struct page;
+struct shmem;
+struct thread;
+
+/* Type marker of pages of shared memory. */
+#define VM_SHMEM VM_MARKER_2
+
+/* FD of mmap() asking for shared anonymous memory. */
+#define MAP_ANONYMOUS (-1)
+
+/* Largest shared object, in pages. */
+#define SHMEM_PAGES_MAX 1024
+
+/* A page of a process mapping page IDX of OBJ. */
+struct shmem_page {
+	struct shmem *obj;
+	size_t idx;
+	struct thread *owner;
+	struct list_elem elem;      /* In the mapper list of the object's page. */
+};
+
+void shmem_init (void);
+void *shmem_mmap (void *addr, size_t length, bool writable);
+struct shmem *shmem_get (struct shmem *);
+void shmem_put (struct shmem *);
+bool shmem_alloc_page (struct shmem *, void *va, size_t idx, bool writable);
+bool shmem_is_page (struct page *page);
+bool shmem_map_page (struct page *page, void **kva);
+void *shmem_reclaim (void);
+
+#endif /* vm/shmem.h */
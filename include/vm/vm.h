@@ -2,6 +2,7 @@
 #define VM_VM_H
 #include <stdbool.h>
 #include "threads/palloc.h"
+#include "threads/synch.h"
 #include "hash.h"
 
 
@@ -22,6 +23,7 @@ enum vm_type {
 	 * markers, until the value is fit in the int. */
 	VM_MARKER_0 = (1 << 3),
 	VM_MARKER_1 = (1 << 4),
+	VM_MARKER_2 = (1 << 5),
 
 	/* DO NOT EXCEED THIS VALUE. */
 	VM_MARKER_END = (1 << 31),
@@ -30,6 +32,9 @@ enum vm_type {
 #include "vm/uninit.h"
 #include "vm/anon.h"
 #include "vm/file.h"
+#include "vm/vma.h"
+#include "vm/shmem.h"
+#include "vm/fcache.h"
 #ifdef EFILESYS
 #include "filesys/page_cache.h"
 #endif
@@ -56,6 +61,8 @@ struct page {
 
 	bool writable;
 	bool is_loaded;
+	bool busy;             /* Being brought in, evicted, written back or
+	                          freed, see vm_lock_page(). */
 
 	/* Per-type data are binded into the union.
 	 * Each function automatically detects the current union */
@@ -63,6 +70,8 @@ struct page {
 		struct uninit_page uninit;
 		struct anon_page anon;
 		struct file_page file;
+		struct shmem_page shmem;
+		struct text_page text;
 #ifdef EFILESYS
 		struct page_cache page_cache;
 #endif
@@ -73,8 +82,13 @@ struct page {
 struct frame {
 	void *kva;
 	struct page *page;
+	struct thread *owner;  /* Process whose page table maps PAGE. */
+	int pin_cnt;           /* Not to be evicted unless 0, see vm_pin_page().
+	                          Changed atomically: mappers of a shared
+	                          frame pin it independently. */
 
-	struct list_elem frame_elem;
+	struct list_elem frame_elem;  /* On the global clock. */
+	struct list_elem owner_elem;  /* On OWNER's clock. */
 };
 
 /* The function table for page operations.
@@ -98,8 +112,55 @@ struct page_operations {
  * All designs up to you for this. */
 struct supplemental_page_table {
 	struct hash* pages;
+	struct vma_table vmas;  /* ELF segments and mmaps, see vm/vma.c. */
+
+	/* Held for reading while a fault is handled or a page is evicted,
+	 * and for writing while pages or areas are added or removed by
+	 * mmap(), munmap(), madvise() or exit. */
+	struct rwlock lock;
+
+	/* Fault-around state. The window doubles while faults keep landing
+	 * right after the previously populated range and resets otherwise. */
+	void *fa_next;         /* First page after the last fault-around window. */
+	size_t fa_window;      /* Pages populated on the last fault. */
+	int fa_streak;         /* Faults in a row that landed on FA_NEXT. */
 };
 
+/* Stack limits, in bytes. Below the lowest address the stack may grow
+ * to, STACK_GUARD bytes are kept free of mappings so that an overflow
+ * always faults. */
+#define STACK_LIMIT_DEFAULT (1 << 20)
+#define STACK_LIMIT_MAX (8 << 20)
+#define STACK_GUARD (64 * 1024)
+
+/* Resources for setrlimit(). */
+#define RLIMIT_STACK 0          /* Maximum stack size. */
+#define RLIMIT_RSS 1            /* Maximum resident set size. */
+#define RLIMIT_RSS_MIN 2        /* Guaranteed resident set size. */
+
+/* Smallest resident limit, in pages, with which one instruction and the
+ * data it touches can still be brought in together. */
+#define RSS_LIMIT_MIN 8
+
+/* Paging activity of a process, see getrusage(). The event counts are
+ * kept in the thread, RSS and SWAP are counted when asked for. */
+struct rusage {
+	long minflt;            /* Faults served without reading the disk. */
+	long majflt;            /* Faults that read from the disk. */
+	long fileflt;           /* Faults on mmap'd pages. */
+	long stackflt;          /* Faults that grew the stack. */
+	long swapin;            /* Pages read back from swap. */
+	long swapout;           /* Pages written to swap. */
+	long inblock;           /* Pages read from files or swap. */
+	long oublock;           /* Pages written back to files or swap. */
+	long fault_cycles;      /* CPU cycles spent handling faults. */
+	long rss;               /* Pages resident now. */
+	long swap;              /* Pages in swap now. */
+};
+
+/* Print each process's usage when it exits, set by "-vmstat". */
+extern bool vm_print_rusage;
+
 #include "threads/thread.h"
 void supplemental_page_table_init (struct supplemental_page_table *spt);
 bool supplemental_page_table_copy (struct supplemental_page_table *dst,
@@ -107,6 +168,9 @@ bool supplemental_page_table_copy (struct supplemental_page_table *dst,
 void supplemental_page_table_kill (struct supplemental_page_table *spt);
 struct page *spt_find_page (struct supplemental_page_table *spt,
 		void *va);
+struct page *spt_get_page (struct supplemental_page_table *spt, void *va);
+bool spt_range_free (struct supplemental_page_table *spt, void *start,
+		void *end);
 bool spt_insert_page (struct supplemental_page_table *spt, struct page *page);
 void spt_remove_page (struct supplemental_page_table *spt, struct page *page);
 
@@ -118,8 +182,26 @@ bool vm_try_handle_fault (struct intr_frame *f, void *addr, bool user,
 	vm_alloc_page_with_initializer ((type), (upage), (writable), NULL, NULL)
 bool vm_alloc_page_with_initializer (enum vm_type type, void *upage,
 		bool writable, vm_initializer *init, void *aux);
+bool vm_zero_page (struct page *page, void *aux);
 void vm_dealloc_page (struct page *page);
 bool vm_claim_page (void *va);
+bool vm_madvise (void *start, void *end, int advice);
+struct page *vm_get_page (void *va, uintptr_t rsp);
+bool vm_stack_reserved (void *start, void *end);
+bool vm_set_stack_limit (size_t limit);
+bool vm_set_rss_limit (size_t limit);
+bool vm_set_rss_min (size_t min);
+void vm_get_rusage (struct rusage *usage);
+void vm_exit_rusage (void);
+void vm_remove_frame (struct frame *frame);
+void vm_lock_page (struct page *page);
+bool vm_try_lock_page (struct page *page);
+void vm_unlock_page (struct page *page);
+bool vm_pin_page (struct page *page);
+void vm_unpin_page (struct page *page);
+bool vm_frame_pinned (struct frame *frame);
+size_t vm_scan_frames (bool (*pred) (struct frame *), struct frame **frames,
+		size_t max);
 enum vm_type page_get_type (struct page *page);
 unsigned
 page_hash (const struct hash_elem *p_, void *aux UNUSED);
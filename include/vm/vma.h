@@ -0,0 +1,63 @@
+#ifndef VM_VMA_H
+#define VM_VMA_H
+#include <stdbool.h>
+#include <stddef.h>
+#include "filesys/off_t.h"
+
+struct file;
+struct page;
+struct shmem;
+
+/* Kinds of area. */
+#define VMA_SEGMENT 0x1         /* ELF segment, a private copy of the file. */
+#define VMA_MMAP    0x2         /* mmap'd file, written back to the file. */
+#define VMA_SHARED  0x4         /* Shared anonymous memory, see shmem.c. */
+
+/* madvise() advice. */
+#define MADV_NORMAL     0       /* No special treatment. */
+#define MADV_RANDOM     1       /* No read-around on faults. */
+#define MADV_SEQUENTIAL 2       /* Read ahead a lot, drop pages behind. */
+#define MADV_WILLNEED   3       /* Start reading the range in now. */
+#define MADV_DONTNEED   4       /* Discard the range's contents. */
+
+/* A virtual memory area: a run of pages backed the same way. The struct
+ * page of each page in it is only created when the page is first used. */
+struct vma {
+	void *start;                /* First page. */
+	void *end;                  /* One past the last page. */
+	struct file *file;          /* Backing file, owned by the area. */
+	struct shmem *shm;          /* Shared object, if VMA_SHARED. */
+	off_t offset;               /* File offset of START. */
+	size_t read_bytes;          /* File bytes from START on, rest is zero. */
+	bool writable;
+	int flags;                  /* VMA_* */
+	int advice;                 /* MADV_NORMAL, _RANDOM or _SEQUENTIAL. */
+};
+
+/* Areas of one process, sorted by address. */
+struct vma_table {
+	struct vma **areas;
+	size_t cnt;
+	size_t cap;
+};
+
+void vma_table_init (struct vma_table *vmas);
+void vma_table_destroy (struct vma_table *vmas);
+bool vma_table_copy (struct vma_table *dst, const struct vma_table *src,
+		int flags);
+
+struct vma *vma_create (struct vma_table *vmas, void *start, size_t length,
+		struct file *file, off_t offset, size_t read_bytes, bool writable,
+		int flags);
+void vma_destroy (struct vma_table *vmas, struct vma *vma);
+void vma_shrink (struct vma *vma, void *start, void *end);
+struct vma *vma_split (struct vma_table *vmas, struct vma *vma, void *va);
+struct vma *vma_find (const struct vma_table *vmas, const void *va);
+struct vma *vma_next (const struct vma_table *vmas, const void *va);
+bool vma_overlaps (const struct vma_table *vmas, const void *start,
+		const void *end);
+off_t vma_page_offset (const struct vma *vma, const void *va);
+size_t vma_page_read_bytes (const struct vma *vma, const void *va);
+bool vma_alloc_page (struct vma *vma, void *va);
+
+#endif /* vm/vma.h */
@@ -54,7 +54,7 @@ static __inline int64_t syscall (uint64_t num_, uint64_t a1_, uint64_t a2_,
 			((uint64_t) ARG2), 0, 0, 0))
 
 #define syscall4(NUMBER, ARG0, ARG1, ARG2, ARG3) ( \
-		syscall(((uint64_t *) NUMBER), \
+		syscall(((uint64_t) NUMBER), \
 			((uint64_t) ARG0), \
 			((uint64_t) ARG1), \
 			((uint64_t) ARG2), \
@@ -155,6 +155,84 @@ munmap (void *addr) {
 	syscall1 (SYS_MUNMAP, addr);
 }
 
+int
+msync (void *addr, size_t length, int flags) {
+	return syscall3 (SYS_MSYNC, addr, length, flags);
+}
+
+int
+madvise (void *addr, size_t length, int advice) {
+	return syscall3 (SYS_MADVISE, addr, length, advice);
+}
+
+bool
+setrlimit (int resource, size_t limit) {
+	return syscall2 (SYS_SETRLIMIT, resource, limit);
+}
+
+size_t
+getrlimit (int resource) {
+	return syscall1 (SYS_GETRLIMIT, resource);
+}
+
+int
+getrusage (struct rusage *usage) {
+	return syscall1 (SYS_GETRUSAGE, usage);
+}
+
+int
+pread (int fd, void *buffer, unsigned size, off_t offset) {
+	return syscall4 (SYS_PREAD, fd, buffer, size, offset);
+}
+
+int
+pwrite (int fd, const void *buffer, unsigned size, off_t offset) {
+	return syscall4 (SYS_PWRITE, fd, buffer, size, offset);
+}
+
+int
+readv (int fd, const struct iovec *iov, int iovcnt) {
+	return syscall3 (SYS_READV, fd, iov, iovcnt);
+}
+
+int
+writev (int fd, const struct iovec *iov, int iovcnt) {
+	return syscall3 (SYS_WRITEV, fd, iov, iovcnt);
+}
+
+int
+copy_file_range (int in_fd, off_t in_off, int out_fd, off_t out_off,
+		unsigned length) {
+	return syscall5 (SYS_COPY_FILE_RANGE, in_fd, in_off, out_fd, out_off,
+			length);
+}
+
+struct io_ring *
+ioring_setup (void *addr, unsigned entries) {
+	return (struct io_ring *) syscall2 (SYS_IORING_SETUP, addr, entries);
+}
+
+int
+ioring_enter (unsigned to_submit, unsigned min_complete) {
+	return syscall2 (SYS_IORING_ENTER, to_submit, min_complete);
+}
+
+pid_t
+spawn (const char *path, char *const argv[],
+		const struct spawn_action *fd_actions) {
+	return (pid_t) syscall3 (SYS_SPAWN, path, argv, fd_actions);
+}
+
+int
+pipe (int fds[2]) {
+	return syscall1 (SYS_PIPE, fds);
+}
+
+pid_t
+waitpid (pid_t pid, int *status, int options) {
+	return (pid_t) syscall3 (SYS_WAITPID, pid, status, options);
+}
+
 bool
 chdir (const char *dir) {
 	return syscall1 (SYS_CHDIR, dir);
@@ -0,0 +1,35 @@
+/* Copies sample.txt into a new file and its first line to the console
+   with copy_file_range(), and checks how the file positions move. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void)
+{
+  int in, out;
+  int size = sizeof sample - 1;
+  int line = strchr (sample, '\n') - sample + 1;
+
+  CHECK ((in = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  CHECK (create ("copy.txt", size), "create \"copy.txt\"");
+  CHECK ((out = open ("copy.txt")) > 1, "open \"copy.txt\"");
+  CHECK (copy_file_range (in, -1, out, 0, size + 100) == size,
+         "copy whole file");
+  CHECK (tell (in) == (unsigned) size, "input position advanced");
+  CHECK (tell (out) == 0, "output position unchanged");
+  CHECK (copy_file_range (in, -1, out, 0, 1) == 0, "copy at end of file");
+  CHECK (copy_file_range (in, -2, out, 0, 1) == -1, "copy at bad offset");
+  CHECK (copy_file_range (0, 0, out, 0, 1) == -1, "copy from console");
+  CHECK (copy_file_range (in, 0, 0, 0, 1) == -1, "copy to keyboard");
+  close (out);
+  check_file ("copy.txt", sample, size);
+
+  msg ("copy first line to console");
+  CHECK (copy_file_range (in, 0, 1, -1, line) == line,
+         "copied %d bytes to console", line);
+  close (in);
+}
@@ -0,0 +1,26 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(copy-file-range) begin
+(copy-file-range) open "sample.txt"
+(copy-file-range) create "copy.txt"
+(copy-file-range) open "copy.txt"
+(copy-file-range) copy whole file
+(copy-file-range) input position advanced
+(copy-file-range) output position unchanged
+(copy-file-range) copy at end of file
+(copy-file-range) copy at bad offset
+(copy-file-range) copy from console
+(copy-file-range) copy to keyboard
+(copy-file-range) open "copy.txt" for verification
+(copy-file-range) verified contents of "copy.txt"
+(copy-file-range) close "copy.txt"
+(copy-file-range) copy first line to console
+"KAIST is the first and top science and technology university in Korea.
+(copy-file-range) copied 72 bytes to console
+(copy-file-range) end
+copy-file-range: exit(0)
+EOF
+pass;
@@ -25,6 +25,12 @@ test_main (void)
   if ((pid = fork ("child-read"))){
     wait (pid);
 
+    /* The child read through the same open file, so the position
+       it left behind is ours as well. */
+    if (tell (handle) != sizeof sample - 1)
+      fail ("tell() returned %u instead of %zu",
+            tell (handle), sizeof sample - 1);
+    seek (handle, 20);
     byte_cnt = read (handle, buffer + 20, sizeof sample - 21);
     if (byte_cnt != sizeof sample - 21)
       fail ("read() returned %d instead of %zu", byte_cnt, sizeof sample - 21);
@@ -1,5 +1,6 @@
 /* After fork, the child process will read and close the opened file
-   and the parent will access the closed file. */
+   and the parent will access the closed file.  Both share the file's
+   position, so the parent sees where the child stopped reading. */
 
 #include <string.h>
 #include <syscall.h>
@@ -24,6 +25,12 @@ test_main (void)
   if ((pid = fork("child"))){
     wait (pid);
 
+    /* The child read through the same open file, so the position
+       it left behind is ours as well. */
+    if (tell (handle) != sizeof sample - 1)
+      fail ("tell() returned %u instead of %zu",
+            tell (handle), sizeof sample - 1);
+    seek (handle, 20);
     byte_cnt = read (handle, buffer + 20, sizeof sample - 21);
     if (byte_cnt != sizeof sample - 21)
       fail ("read() returned %d instead of %zu", byte_cnt, sizeof sample - 21);
@@ -0,0 +1,20 @@
+/* Sets up an I/O ring, which puts kernel threads to work for the
+   process, and checks that waiting for any child still finds that
+   the process has none. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define RING ((void *) 0x10000000)
+
+void
+test_main (void)
+{
+  int status;
+  pid_t r;
+
+  CHECK (ioring_setup (RING, 8) == RING, "ioring_setup");
+  r = waitpid (-1, &status, 0);
+  CHECK (r == -1, "waitpid without children");
+}
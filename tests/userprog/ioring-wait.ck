@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(ioring-wait) begin
+(ioring-wait) ioring_setup
+(ioring-wait) waitpid without children
+(ioring-wait) end
+ioring-wait: exit(0)
+EOF
+pass;
@@ -0,0 +1,98 @@
+/* Opens, reads, writes and syncs files through an I/O ring, with
+   several requests in flight at once. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define RING ((void *) 0x10000000)
+#define READS 4
+#define CHUNK 64
+
+static struct io_ring *ring;
+
+/* Queues a request and returns it. */
+static struct io_sqe *
+queue (int opcode, int fd, void *buf, unsigned len, off_t offset,
+       uint64_t user_data)
+{
+  struct io_sqe *sqe = &ring->sqes[ring->sq_tail & ring->sq_mask];
+
+  memset (sqe, 0, sizeof *sqe);
+  sqe->opcode = opcode;
+  sqe->fd = fd;
+  sqe->buf = buf;
+  sqe->len = len;
+  sqe->offset = offset;
+  sqe->user_data = user_data;
+  ring->sq_tail++;
+  return sqe;
+}
+
+/* Takes the next completion off the ring. */
+static struct io_cqe
+reap (void)
+{
+  if (ring->cq_head == ring->cq_tail)
+    fail ("completion queue is empty");
+  return ring->cqes[ring->cq_head++ & ring->cq_mask];
+}
+
+void
+test_main (void)
+{
+  char bufs[READS][CHUNK];
+  char expected[16] = "hello";
+  struct io_cqe cqe;
+  int fd, i;
+
+  CHECK ((ring = ioring_setup (RING, 8)) == RING, "ioring_setup");
+  CHECK (ioring_setup (RING + 0x100000, 8) == NULL, "second ring refused");
+
+  queue (IORING_OP_OPEN, 0, "sample.txt", 0, 0, 100);
+  CHECK (ioring_enter (1, 1) == 1, "submit open");
+  cqe = reap ();
+  if (cqe.user_data != 100 || cqe.res < 2)
+    fail ("open completed with %d", cqe.res);
+  fd = cqe.res;
+
+  for (i = 0; i < READS; i++)
+    queue (IORING_OP_READ, fd, bufs[i], CHUNK, i * CHUNK, i);
+  queue (IORING_OP_READ, 0, bufs[0], CHUNK, 0, READS);
+  CHECK (ioring_enter (READS + 1, READS + 1) == READS + 1,
+         "submit %d reads", READS + 1);
+  for (i = 0; i <= READS; i++)
+    {
+      cqe = reap ();
+      if (cqe.user_data == READS)
+        {
+          if (cqe.res != -1)
+            fail ("read from console completed with %d", cqe.res);
+          continue;
+        }
+      if (cqe.user_data > READS || cqe.res != CHUNK)
+        fail ("read %d completed with %d", (int) cqe.user_data, cqe.res);
+    }
+  for (i = 0; i < READS; i++)
+    compare_bytes (bufs[i], sample + i * CHUNK, CHUNK, i * CHUNK,
+                   "sample.txt");
+  msg ("reads verified");
+  close (fd);
+
+  CHECK (create ("test.txt", sizeof expected), "create \"test.txt\"");
+  CHECK ((fd = open ("test.txt")) > 1, "open \"test.txt\"");
+  queue (IORING_OP_WRITE, fd, "hello", 5, 0, 200);
+  CHECK (ioring_enter (1, 1) == 1, "submit write");
+  cqe = reap ();
+  if (cqe.user_data != 200 || cqe.res != 5)
+    fail ("write completed with %d", cqe.res);
+  queue (IORING_OP_FSYNC, fd, NULL, 0, 0, 300);
+  CHECK (ioring_enter (1, 1) == 1, "submit fsync");
+  cqe = reap ();
+  if (cqe.user_data != 300 || cqe.res != 0)
+    fail ("fsync completed with %d", cqe.res);
+  close (fd);
+  check_file ("test.txt", expected, sizeof expected);
+}
@@ -0,0 +1,22 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(ioring) begin
+(ioring) ioring_setup
+(ioring) second ring refused
+(ioring) submit open
+(ioring) submit 5 reads
+(ioring) reads verified
+(ioring) create "test.txt"
+(ioring) open "test.txt"
+(ioring) submit write
+(ioring) submit fsync
+(ioring) open "test.txt" for verification
+(ioring) verified contents of "test.txt"
+(ioring) close "test.txt"
+(ioring) end
+ioring: exit(0)
+EOF
+pass;
@@ -0,0 +1,67 @@
+/* Sends a line and then a few pages through a pipe from a child whose
+   standard output is the writing end, and checks that the parent reads
+   them back in order and then sees end of file.  Finally, writes to a
+   pipe whose reading end is closed, which must fail. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define BIG_SIZE (3 * 4096 + 100)
+
+static char big[BIG_SIZE];
+static char got[BIG_SIZE + 1];
+
+/* Reads from FD into BUF until SIZE bytes or end of file, and returns
+   the number of bytes read. */
+static int
+read_all (int fd, char *buf, int size)
+{
+  int total = 0, n;
+
+  while (total < size && (n = read (fd, buf + total, size - total)) > 0)
+    total += n;
+  return total;
+}
+
+void
+test_main (void)
+{
+  static const char line[] = "through the pipe\n";
+  char buf[sizeof line];
+  int fds[2];
+  pid_t pid;
+  int i;
+
+  for (i = 0; i < BIG_SIZE; i++)
+    big[i] = i % 251;
+
+  CHECK (pipe (fds) == 0, "pipe");
+  pid = fork ("child");
+  if (pid == 0)
+    {
+      close (fds[0]);
+      dup2 (fds[1], 1);
+      close (fds[1]);
+      write (1, line, sizeof line - 1);
+      exit (write (1, big, BIG_SIZE) == BIG_SIZE ? 0 : 1);
+    }
+
+  close (fds[1]);
+  memset (buf, 0, sizeof buf);
+  if (read_all (fds[0], buf, sizeof line - 1) != sizeof line - 1
+      || strcmp (buf, line))
+    fail ("read wrong line from child");
+  i = read_all (fds[0], got, sizeof got);
+  if (i != BIG_SIZE || memcmp (got, big, BIG_SIZE))
+    fail ("read %d bytes from child instead of %d", i, BIG_SIZE);
+  CHECK (read (fds[0], got, 1) == 0, "end of file");
+  msg ("wait(fork()) = %d", wait (pid));
+  close (fds[0]);
+
+  CHECK (pipe (fds) == 0, "pipe");
+  close (fds[0]);
+  CHECK (write (fds[1], line, sizeof line - 1) == -1, "write without reader");
+  close (fds[1]);
+}
@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(pipe) begin
+(pipe) pipe
+child: exit(0)
+(pipe) end of file
+(pipe) wait(fork()) = 0
+(pipe) pipe
+(pipe) write without reader
+(pipe) end
+pipe: exit(0)
+EOF
+pass;
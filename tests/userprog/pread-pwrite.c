@@ -0,0 +1,36 @@
+/* Reads and writes at explicit offsets with pread() and pwrite(), and
+   checks that neither moves the file position. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void)
+{
+  char buf[32];
+  int handle;
+
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  CHECK (pread (handle, buf, 20, 10) == 20, "pread 20 bytes at offset 10");
+  compare_bytes (buf, sample + 10, 20, 10, "sample.txt");
+  CHECK (tell (handle) == 0, "file position unchanged");
+  CHECK (pread (handle, buf, sizeof buf, sizeof sample - 1) == 0,
+         "pread at end of file");
+  CHECK (pread (handle, buf, 1, -1) == -1, "pread at negative offset");
+  CHECK (pread (0, buf, 1, 0) == -1, "pread from console");
+  close (handle);
+
+  CHECK (create ("test.txt", 16), "create \"test.txt\"");
+  CHECK ((handle = open ("test.txt")) > 1, "open \"test.txt\"");
+  CHECK (pwrite (handle, "world", 5, 6) == 5, "pwrite \"world\" at 6");
+  CHECK (pwrite (handle, "hello ", 6, 0) == 6, "pwrite \"hello \" at 0");
+  CHECK (tell (handle) == 0, "file position unchanged");
+  memset (buf, 0, sizeof buf);
+  CHECK (read (handle, buf, 11) == 11, "read back");
+  if (strcmp (buf, "hello world"))
+    fail ("read \"%s\" instead of \"hello world\"", buf);
+  close (handle);
+}
@@ -0,0 +1,22 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(pread-pwrite) begin
+(pread-pwrite) open "sample.txt"
+(pread-pwrite) pread 20 bytes at offset 10
+(pread-pwrite) file position unchanged
+(pread-pwrite) pread at end of file
+(pread-pwrite) pread at negative offset
+(pread-pwrite) pread from console
+(pread-pwrite) create "test.txt"
+(pread-pwrite) open "test.txt"
+(pread-pwrite) pwrite "world" at 6
+(pread-pwrite) pwrite "hello " at 0
+(pread-pwrite) file position unchanged
+(pread-pwrite) read back
+(pread-pwrite) end
+pread-pwrite: exit(0)
+EOF
+pass;
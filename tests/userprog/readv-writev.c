@@ -0,0 +1,42 @@
+/* Gathers several buffers into a file with writev() and scatters them
+   back with readv(), and writes a line to the console with writev(). */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void)
+{
+  char a[4], b[8];
+  struct iovec out[] = {
+    { "abc", 3 },
+    { "", 0 },
+    { "defgh", 5 },
+  };
+  struct iovec in[] = {
+    { a, sizeof a },
+    { b, sizeof b },
+  };
+  struct iovec console[] = {
+    { "(readv-writev) ", 15 },
+    { "writev to console\n", 18 },
+  };
+  int handle;
+
+  CHECK (create ("test.txt", 8), "create \"test.txt\"");
+  CHECK ((handle = open ("test.txt")) > 1, "open \"test.txt\"");
+  CHECK (writev (handle, out, 3) == 8, "writev 3 buffers");
+  CHECK (tell (handle) == 8, "file position advanced");
+
+  seek (handle, 0);
+  memset (b, 0, sizeof b);
+  CHECK (readv (handle, in, 2) == 8, "readv 2 buffers");
+  if (memcmp (a, "abcd", 4) || memcmp (b, "efgh", 4))
+    fail ("read back wrong data");
+  CHECK (readv (handle, in, 0) == -1, "readv 0 buffers");
+  close (handle);
+
+  writev (1, console, 2);
+}
@@ -0,0 +1,40 @@
+/* Starts children with spawn(): one with arguments, one that gets a
+   descriptor moved to another number, and one that does not exist. */
+
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void)
+{
+  char *args[] = { "child-args", "spawned", "args", NULL };
+  char *close_args[] = { "child-close", "20", NULL };
+  char *missing_args[] = { "no-such-file", NULL };
+  struct spawn_action actions[] = {
+    { SPAWN_DUP2, 0, 20 },
+    { SPAWN_CLOSE, 0, 0 },
+    { SPAWN_END, 0, 0 },
+  };
+  pid_t pid;
+  int handle;
+
+  pid = spawn ("child-args", args, NULL);
+  if (pid == -1)
+    fail ("spawn \"child-args\" failed");
+  msg ("wait(spawn()) = %d", wait (pid));
+
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  actions[0].fd = actions[1].fd = handle;
+  pid = spawn ("child-close", close_args, actions);
+  if (pid == -1)
+    fail ("spawn \"child-close\" failed");
+  msg ("wait(spawn()) = %d", wait (pid));
+  CHECK (tell (handle) == sizeof sample - 1, "position shared with child");
+  seek (handle, 0);
+  check_file_handle (handle, "sample.txt", sample, sizeof sample - 1);
+  close (handle);
+
+  msg ("spawn missing program: %d", spawn ("no-such-file", missing_args, NULL));
+}
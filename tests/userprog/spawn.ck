@@ -0,0 +1,30 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(spawn) begin
+(args) begin
+(args) argc = 3
+(args) argv[0] = 'child-args'
+(args) argv[1] = 'spawned'
+(args) argv[2] = 'args'
+(args) argv[3] = null
+(args) end
+child-args: exit(0)
+(spawn) wait(spawn()) = 0
+(spawn) open "sample.txt"
+(child-close) begin
+(child-close) verified contents of "sample.txt"
+(child-close) end
+child-close: exit(0)
+(spawn) wait(spawn()) = 0
+(spawn) position shared with child
+(spawn) verified contents of "sample.txt"
+load: no-such-file: open failed
+no-such-file: exit(-1)
+(spawn) spawn missing program: -1
+(spawn) end
+spawn: exit(0)
+EOF
+pass;
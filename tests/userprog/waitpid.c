@@ -0,0 +1,54 @@
+/* Checks waitpid() on a child that cannot exit yet, which WNOHANG
+   must not wait for, then reaps children by pid and as "any child"
+   in whatever order they are asked for. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+/* Forks a child that exits with STATUS at once. */
+static pid_t
+spawn_exiting (int status)
+{
+  pid_t pid = fork ("child");
+  if (pid == 0)
+    exit (status);
+  return pid;
+}
+
+void
+test_main (void)
+{
+  int fds[2];
+  int status = 0;
+  pid_t pid, a, b, r;
+  char c;
+
+  r = waitpid (-1, &status, WNOHANG);
+  CHECK (r == -1, "waitpid without children");
+
+  CHECK (pipe (fds) == 0, "pipe");
+  pid = fork ("child");
+  if (pid == 0)
+    {
+      /* Blocks until the parent closes the writing end. */
+      close (fds[1]);
+      exit (read (fds[0], &c, 1) == 0 ? 81 : 1);
+    }
+  r = waitpid (-1, &status, WNOHANG);
+  CHECK (r == 0, "waitpid with WNOHANG while the child runs");
+  close (fds[1]);
+  close (fds[0]);
+  r = waitpid (-1, &status, 0);
+  CHECK (r == pid && status == 81, "waitpid for any child");
+
+  a = spawn_exiting (7);
+  b = spawn_exiting (7);
+  r = waitpid (b, &status, 0);
+  CHECK (r == b && status == 7, "waitpid for the second child");
+  r = waitpid (-1, NULL, 0);
+  CHECK (r == a, "waitpid for any child finds the first");
+  r = waitpid (a, &status, WNOHANG);
+  CHECK (r == -1, "waitpid for a reaped child");
+  CHECK (wait (pid) == -1, "wait for a reaped child");
+}
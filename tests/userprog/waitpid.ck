@@ -0,0 +1,21 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(waitpid) begin
+(waitpid) waitpid without children
+(waitpid) pipe
+(waitpid) waitpid with WNOHANG while the child runs
+child: exit(81)
+(waitpid) waitpid for any child
+child: exit(7)
+child: exit(7)
+(waitpid) waitpid for the second child
+(waitpid) waitpid for any child finds the first
+(waitpid) waitpid for a reaped child
+(waitpid) wait for a reaped child
+(waitpid) end
+waitpid: exit(0)
+EOF
+pass;
@@ -0,0 +1,41 @@
+/* Checks that a large BSS array reads as zeros, in the parent and in a
+   child forked before most of the array was touched. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_CNT 64
+
+static char bss[PAGE_CNT * 4096];
+
+static void
+check_zero (size_t first, size_t last)
+{
+  size_t i;
+
+  for (i = first * 4096; i < last * 4096; i++)
+    if (bss[i] != 0)
+      fail ("bss[%zu] is %d, not zero", i, bss[i]);
+}
+
+void
+test_main (void)
+{
+  pid_t child;
+
+  check_zero (0, PAGE_CNT / 4);
+  bss[0] = 'p';
+
+  child = fork ("child");
+  if (child == 0)
+    {
+      check_zero (PAGE_CNT / 4, PAGE_CNT);
+      if (bss[0] != 'p')
+        fail ("child lost the parent's write");
+      exit (81);
+    }
+  CHECK (wait (child) == 81, "wait for child");
+  check_zero (PAGE_CNT / 2, PAGE_CNT);
+  msg ("bss is zero");
+}
@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(bss-zero) begin
+(bss-zero) wait for child
+(bss-zero) bss is zero
+(bss-zero) end
+EOF
+pass;
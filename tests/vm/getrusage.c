@@ -0,0 +1,50 @@
+/* Checks that getrusage() counts faults and resident pages, and that it
+   fails cleanly on a bad pointer. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_CNT 16
+
+/* One page more than PAGE_CNT, since the first page may already be
+   resident. */
+static char buf[(PAGE_CNT + 1) * 4096];
+
+static void __attribute__ ((noinline))
+grow_stack (void)
+{
+  char stk_obj[(PAGE_CNT + 1) * 4096];
+
+  memset (stk_obj, 'a', sizeof stk_obj);
+  if (stk_obj[0] != 'a')
+    fail ("stack contents lost");
+}
+
+void
+test_main (void)
+{
+  struct rusage before, after;
+  size_t i;
+
+  CHECK (getrusage (&before) == 0, "getrusage");
+  for (i = 0; i <= PAGE_CNT; i++)
+    buf[i * 4096] = 1;
+  CHECK (getrusage (&after) == 0, "getrusage after touching bss");
+  if (after.minflt + after.majflt - before.minflt - before.majflt < PAGE_CNT)
+    fail ("counted %ld faults, expected at least %d",
+          after.minflt + after.majflt - before.minflt - before.majflt,
+          PAGE_CNT);
+  if (after.rss - before.rss < PAGE_CNT)
+    fail ("rss grew by %ld pages, expected at least %d",
+          after.rss - before.rss, PAGE_CNT);
+
+  grow_stack ();
+  CHECK (getrusage (&after) == 0, "getrusage after growing the stack");
+  if (after.stackflt - before.stackflt < PAGE_CNT)
+    fail ("counted %ld stack faults, expected at least %d",
+          after.stackflt - before.stackflt, PAGE_CNT);
+
+  CHECK (getrusage (NULL) == -1, "getrusage on a bad pointer fails");
+}
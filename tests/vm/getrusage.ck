@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(getrusage) begin
+(getrusage) getrusage
+(getrusage) getrusage after touching bss
+(getrusage) getrusage after growing the stack
+(getrusage) getrusage on a bad pointer fails
+(getrusage) end
+EOF
+pass;
@@ -0,0 +1,57 @@
+/* Gives each kind of advice for a file mapping and a page of
+   BSS, checking that the data stays correct and that
+   MADV_DONTNEED discards what was written to the BSS page and to
+   a page of the stack. */
+
+#include <round.h>
+#include <stdint.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/vm/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static char bss[3 * 4096];
+
+/* Fills a page of the stack, discards it and returns true if it reads
+   back as zeros. */
+static bool
+discard_stack_page (void)
+{
+  char stack[3 * 4096];
+  char *page = (char *) ROUND_UP ((uintptr_t) stack, 4096);
+
+  memset (page, 'x', 4096);
+  if (madvise (page, 4096, MADV_DONTNEED) != 0)
+    return false;
+  for (int i = 0; i < 4096; i++)
+    if (page[i] != 0)
+      return false;
+  return true;
+}
+
+void
+test_main (void)
+{
+  char *actual = (char *) 0x10000000;
+  char *page = (char *) ROUND_UP ((uintptr_t) bss, 4096);
+  int handle;
+
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  CHECK (mmap (actual, 4096, 0, handle, 0) != MAP_FAILED, "mmap \"sample.txt\"");
+  CHECK (madvise (actual, 4096, MADV_WILLNEED) == 0, "madvise willneed");
+  CHECK (madvise (actual, 4096, MADV_SEQUENTIAL) == 0, "madvise sequential");
+  if (memcmp (actual, sample, strlen (sample)))
+    fail ("read of mmap'd file reported bad data");
+  CHECK (madvise (actual, 4096, MADV_DONTNEED) == 0, "madvise dontneed");
+  if (memcmp (actual, sample, strlen (sample)))
+    fail ("mmap'd file lost its data");
+  munmap (actual);
+
+  memset (page, 'x', 4096);
+  CHECK (madvise (page, 4096, MADV_DONTNEED) == 0, "discard bss page");
+  CHECK (page[0] == 0 && page[4095] == 0, "bss page reads back as zeros");
+  CHECK (discard_stack_page (), "stack page reads back as zeros");
+  CHECK (madvise (page, 4096, 99) == -1, "bad advice is rejected");
+  close (handle);
+}
@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(madvise) begin
+(madvise) open "sample.txt"
+(madvise) mmap "sample.txt"
+(madvise) madvise willneed
+(madvise) madvise sequential
+(madvise) madvise dontneed
+(madvise) discard bss page
+(madvise) bss page reads back as zeros
+(madvise) stack page reads back as zeros
+(madvise) bad advice is rejected
+(madvise) end
+EOF
+pass;
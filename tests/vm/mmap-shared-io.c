@@ -0,0 +1,71 @@
+/* Two processes write the same shared pages to files at the same
+   time: a page of shared anonymous memory and a page of the program's
+   code, whose frame they share as well. Each process pins the pages
+   for its own writes, so one finishing must not unpin them for the
+   other. Both files must come out holding the pages. */
+
+#include <stdint.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define ACTUAL ((char *) 0x10000000)
+#define ROUNDS 16
+
+static char buf[4096];
+
+/* Writes the shared page and the code page to FILE_NAME ROUNDS times
+   each. Returns true if every write went through. */
+static bool
+write_pages (const char *file_name, const char *code)
+{
+  int fd = open (file_name);
+  bool ok = fd > 1;
+
+  for (int i = 0; ok && i < ROUNDS; i++)
+    ok = write (fd, ACTUAL, 4096) == 4096 && write (fd, code, 4096) == 4096;
+  if (fd > 1)
+    close (fd);
+  return ok;
+}
+
+/* Returns true if FILE_NAME holds ROUNDS copies of the two pages. */
+static bool
+check_pages (const char *file_name, const char *code)
+{
+  int fd = open (file_name);
+  bool ok = fd > 1;
+
+  for (int i = 0; ok && i < 2 * ROUNDS; i++)
+    ok = read (fd, buf, 4096) == 4096
+         && !memcmp (buf, i % 2 ? code : ACTUAL, 4096);
+  if (fd > 1)
+    close (fd);
+  return ok;
+}
+
+void
+test_main (void)
+{
+  const char *code = (const char *) ((uintptr_t) test_main & ~(uintptr_t) 4095);
+  pid_t child;
+  bool ok;
+
+  CHECK (mmap (ACTUAL, 4096, 1, MAP_ANONYMOUS, 0) != MAP_FAILED,
+         "mmap shared memory");
+  for (int i = 0; i < 4096; i++)
+    ACTUAL[i] = i * 7;
+  CHECK (create ("parent", 0), "create \"parent\"");
+  CHECK (create ("child", 0), "create \"child\"");
+
+  child = fork ("child");
+  if (child == 0)
+    exit (write_pages ("child", code) ? 0 : 1);
+  ok = write_pages ("parent", code);
+  CHECK (ok, "write from shared pages");
+  CHECK (wait (child) == 0, "child wrote from shared pages");
+  CHECK (check_pages ("parent", code), "\"parent\" holds the pages");
+  CHECK (check_pages ("child", code), "\"child\" holds the pages");
+  munmap (ACTUAL);
+}
@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(mmap-shared-io) begin
+(mmap-shared-io) mmap shared memory
+(mmap-shared-io) create "parent"
+(mmap-shared-io) create "child"
+(mmap-shared-io) write from shared pages
+(mmap-shared-io) child wrote from shared pages
+(mmap-shared-io) "parent" holds the pages
+(mmap-shared-io) "child" holds the pages
+(mmap-shared-io) end
+EOF
+pass;
@@ -0,0 +1,37 @@
+/* Maps shared anonymous memory and forks. The child checks what
+   the parent wrote and writes a page of its own, which the parent
+   must see once the child is done. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define ACTUAL ((char *) 0x10000000)
+
+static const char parent_msg[] = "written by the parent";
+static const char child_msg[] = "written by the child";
+
+void
+test_main (void)
+{
+  pid_t child;
+
+  CHECK (mmap (ACTUAL, 2 * 4096, 1, MAP_ANONYMOUS, 0) != MAP_FAILED,
+         "mmap shared memory");
+  strlcpy (ACTUAL, parent_msg, sizeof parent_msg);
+
+  child = fork ("child");
+  if (child == 0)
+    {
+      if (strcmp (ACTUAL, parent_msg))
+        exit (1);
+      strlcpy (ACTUAL + 4096, child_msg, sizeof child_msg);
+      exit (0);
+    }
+  CHECK (wait (child) == 0, "wait for child");
+  CHECK (!strcmp (ACTUAL + 4096, child_msg), "child's write is visible");
+  CHECK (mmap ((char *) 0x20000000, 4096, 1, MAP_ANONYMOUS, 4096)
+         == MAP_FAILED, "mmap with offset fails");
+  munmap (ACTUAL);
+}
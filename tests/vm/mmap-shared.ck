@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(mmap-shared) begin
+(mmap-shared) mmap shared memory
+(mmap-shared) wait for child
+(mmap-shared) child's write is visible
+(mmap-shared) mmap with offset fails
+(mmap-shared) end
+EOF
+pass;
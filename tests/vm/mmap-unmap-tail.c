@@ -0,0 +1,40 @@
+/* Maps a two-page file, writes to both pages, and unmaps only
+   the second one.  The first page must stay mapped, the second
+   page's address must become free again, and the data written to
+   it must reach the file right away. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define ACTUAL ((char *) 0x10000000)
+
+void
+test_main (void)
+{
+  int handle;
+  char buf[2];
+
+  CHECK (create ("tail.bin", 8192), "create \"tail.bin\"");
+  CHECK ((handle = open ("tail.bin")) > 1, "open \"tail.bin\"");
+  CHECK (mmap (ACTUAL, 8192, 1, handle, 0) != MAP_FAILED, "mmap \"tail.bin\"");
+  ACTUAL[0] = 'a';
+  ACTUAL[4096] = 'b';
+
+  msg ("munmap second page");
+  munmap (ACTUAL + 4096);
+  CHECK (ACTUAL[0] == 'a', "first page still mapped");
+  CHECK (mmap (ACTUAL + 4096, 4096, 0, handle, 4096) != MAP_FAILED,
+         "map the second page again");
+  CHECK (ACTUAL[4096] == 'b', "second page was written back");
+  munmap (ACTUAL + 4096);
+  munmap (ACTUAL);
+
+  seek (handle, 4096);
+  read (handle, buf, 1);
+  seek (handle, 0);
+  read (handle, buf + 1, 1);
+  CHECK (buf[0] == 'b' && buf[1] == 'a', "file holds both pages");
+  close (handle);
+}
@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(mmap-unmap-tail) begin
+(mmap-unmap-tail) create "tail.bin"
+(mmap-unmap-tail) open "tail.bin"
+(mmap-unmap-tail) mmap "tail.bin"
+(mmap-unmap-tail) munmap second page
+(mmap-unmap-tail) first page still mapped
+(mmap-unmap-tail) map the second page again
+(mmap-unmap-tail) second page was written back
+(mmap-unmap-tail) file holds both pages
+(mmap-unmap-tail) end
+EOF
+pass;
@@ -0,0 +1,27 @@
+/* Lowers the stack limit and then grows the stack past it.
+   The process must be terminated with -1 exit code, and the
+   kernel must keep running. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static void __attribute__ ((noinline))
+touch (void)
+{
+  char stk_obj[131072];
+
+  memset (stk_obj, 'a', sizeof stk_obj);
+  msg ("stk_obj[0] = %c", stk_obj[0]);
+  fail ("grew the stack past its limit");
+}
+
+void
+test_main (void)
+{
+  CHECK (setrlimit (RLIMIT_STACK, 65536), "lower stack limit to 64 kB");
+  CHECK (getrlimit (RLIMIT_STACK) == 65536, "read back stack limit");
+  msg ("touch 128 kB of stack");
+  touch ();
+}
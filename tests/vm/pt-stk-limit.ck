@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_USER_FAULTS => 1, [<<'EOF']);
+(pt-stk-limit) begin
+(pt-stk-limit) lower stack limit to 64 kB
+(pt-stk-limit) read back stack limit
+(pt-stk-limit) touch 128 kB of stack
+pt-stk-limit: exit(-1)
+EOF
+pass;
@@ -0,0 +1,51 @@
+/* Limits the process to 16 resident pages, then writes 64 pages and
+   reads them back.  The pages over the limit must go to swap, and
+   come back intact.  The same must hold once the process is also
+   guaranteed as many pages as its limit. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define LIMIT 16
+#define PAGE_CNT 64
+
+static char buf[PAGE_CNT * 4096];
+
+/* Writes the pages of BUF with values starting at BASE and reads them
+   back, then checks that at least the pages over the limit were
+   swapped out meanwhile. */
+static void
+cycle_pages (int base)
+{
+  struct rusage before, after;
+  size_t i;
+
+  CHECK (getrusage (&before) == 0, "getrusage");
+  for (i = 0; i < PAGE_CNT; i++)
+    buf[i * 4096] = base + i;
+  for (i = 0; i < PAGE_CNT; i++)
+    if (buf[i * 4096] != (char) (base + i))
+      fail ("page %zu holds %d, expected %d", i, buf[i * 4096],
+            (char) (base + i));
+  msg ("read back %d pages", PAGE_CNT);
+
+  CHECK (getrusage (&after) == 0, "getrusage");
+  if (after.swapout - before.swapout < PAGE_CNT - LIMIT)
+    fail ("swapped out %ld pages, expected at least %d",
+          after.swapout - before.swapout, PAGE_CNT - LIMIT);
+}
+
+void
+test_main (void)
+{
+  CHECK (!setrlimit (RLIMIT_RSS, 4096), "refuse a one-page limit");
+  CHECK (setrlimit (RLIMIT_RSS, LIMIT * 4096), "limit resident set");
+  CHECK (getrlimit (RLIMIT_RSS) == LIMIT * 4096, "read back limit");
+
+  cycle_pages (0);
+
+  CHECK (setrlimit (RLIMIT_RSS_MIN, LIMIT * 4096),
+         "guarantee as much as the limit");
+  cycle_pages (100);
+}
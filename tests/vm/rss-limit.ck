@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(rss-limit) begin
+(rss-limit) refuse a one-page limit
+(rss-limit) limit resident set
+(rss-limit) read back limit
+(rss-limit) getrusage
+(rss-limit) read back 64 pages
+(rss-limit) getrusage
+(rss-limit) guarantee as much as the limit
+(rss-limit) getrusage
+(rss-limit) read back 64 pages
+(rss-limit) getrusage
+(rss-limit) end
+EOF
+pass;
@@ -0,0 +1,19 @@
+/* Checks that a forked child maps the same physical frame as its parent
+   for the read-only code of the program. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void)
+{
+	void *pa = get_phys_addr ((void *) test_main);
+	pid_t child;
+
+	CHECK (pa != NULL, "code page is loaded");
+	child = fork ("child");
+	if (child == 0)
+		exit (get_phys_addr ((void *) test_main) == pa ? 0 : 1);
+	CHECK (wait (child) == 0, "child shares the code frame");
+}
@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(share-text) begin
+(share-text) code page is loaded
+child: exit(0)
+(share-text) child shares the code frame
+(share-text) end
+share-text: exit(0)
+EOF
+pass;
@@ -25,12 +25,14 @@
 #include "userprog/process.h"
 #include "userprog/exception.h"
 #include "userprog/gdt.h"
+#include "userprog/ioring.h"
 #include "userprog/syscall.h"
 #include "userprog/tss.h"
 #endif
 #include "tests/threads/tests.h"
 #ifdef VM
 #include "vm/vm.h"
+#include "vm/fcache.h"
 #endif
 #ifdef FILESYS
 #include "devices/disk.h"
@@ -105,6 +107,9 @@ main (void) {
 	thread_start ();
 	serial_init_queue ();
 	timer_calibrate ();
+#ifdef USERPROG
+	ioring_start ();
+#endif
 	
 #ifdef FILESYS
 	/* Initialize file system. */
@@ -226,6 +231,12 @@ parse_options (char **argv) {
 			user_page_limit = atoi (value);
 		else if (!strcmp (name, "-threads-tests"))
 			thread_tests = true;
+		else if (!strcmp (name, "-strace"))
+			syscall_trace = true;
+#endif
+#ifdef VM
+		else if (!strcmp (name, "-vmstat"))
+			vm_print_rusage = true;
 #endif
 		else
 			PANIC ("unknown option `%s' (use -h for help)", name);
@@ -328,6 +339,10 @@ usage (void) {
 			"  -mlfqs             Use multi-level feedback queue scheduler.\n"
 #ifdef USERPROG
 			"  -ul=COUNT          Limit user memory to COUNT pages.\n"
+			"  -strace            Print each process's last system calls on exit.\n"
+#endif
+#ifdef VM
+			"  -vmstat            Print paging statistics as processes exit.\n"
 #endif
 			);
 	power_off ();
@@ -361,5 +376,9 @@ print_stats (void) {
 	kbd_print_stats ();
 #ifdef USERPROG
 	exception_print_stats ();
+	syscall_print_stats ();
+#endif
+#ifdef VM
+	fcache_print_stats ();
 #endif
 }
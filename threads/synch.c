@@ -415,3 +415,96 @@ void cond_broadcast(struct condition *cond, struct lock *lock)
 	while (!list_empty(&cond->waiters))
 		cond_signal(cond, lock);
 }
+
+/* Initializes RWLOCK, which no one holds. */
+void rwlock_init(struct rwlock *rw)
+{
+	ASSERT(rw != NULL);
+
+	lock_init(&rw->lock);
+	cond_init(&rw->readers_ok);
+	cond_init(&rw->writers_ok);
+	rw->readers = 0;
+	rw->writers_waiting = 0;
+	rw->writer = NULL;
+}
+
+/* Acquires RW for reading, sleeping while a writer holds it or
+   waits for it.  Must not be called by its writer.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+void rwlock_acquire_read(struct rwlock *rw)
+{
+	ASSERT(rw != NULL);
+	ASSERT(rw->writer != thread_current());
+
+	lock_acquire(&rw->lock);
+	while (rw->writer != NULL || rw->writers_waiting > 0)
+		cond_wait(&rw->readers_ok, &rw->lock);
+	rw->readers++;
+	lock_release(&rw->lock);
+}
+
+/* Tries to acquire RW for reading and returns true if successful,
+   false if a writer holds it or waits for it.  Never sleeps on RW
+   itself, only briefly on its internal lock. */
+bool rwlock_try_acquire_read(struct rwlock *rw)
+{
+	bool success;
+
+	ASSERT(rw != NULL);
+
+	lock_acquire(&rw->lock);
+	success = rw->writer == NULL && rw->writers_waiting == 0;
+	if (success)
+		rw->readers++;
+	lock_release(&rw->lock);
+	return success;
+}
+
+/* Releases RW, held for reading by the current thread. */
+void rwlock_release_read(struct rwlock *rw)
+{
+	ASSERT(rw != NULL);
+
+	lock_acquire(&rw->lock);
+	ASSERT(rw->readers > 0);
+	if (--rw->readers == 0)
+		cond_signal(&rw->writers_ok, &rw->lock);
+	lock_release(&rw->lock);
+}
+
+/* Acquires RW for writing, sleeping until no one else holds it.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+void rwlock_acquire_write(struct rwlock *rw)
+{
+	ASSERT(rw != NULL);
+	ASSERT(rw->writer != thread_current());
+
+	lock_acquire(&rw->lock);
+	rw->writers_waiting++;
+	while (rw->writer != NULL || rw->readers > 0)
+		cond_wait(&rw->writers_ok, &rw->lock);
+	rw->writers_waiting--;
+	rw->writer = thread_current();
+	lock_release(&rw->lock);
+}
+
+/* Releases RW, held for writing by the current thread.  Waiting
+   writers go first, then all waiting readers. */
+void rwlock_release_write(struct rwlock *rw)
+{
+	ASSERT(rw != NULL);
+
+	lock_acquire(&rw->lock);
+	ASSERT(rw->writer == thread_current());
+	rw->writer = NULL;
+	if (rw->writers_waiting > 0)
+		cond_signal(&rw->writers_ok, &rw->lock);
+	else
+		cond_broadcast(&rw->readers_ok, &rw->lock);
+	lock_release(&rw->lock);
+}
@@ -108,6 +108,9 @@ void thread_init(void)
 
 	/* Init the globla thread context */
 	lock_init(&tid_lock);
+#ifdef USERPROG
+	child_init();
+#endif
 	list_init(&sleep_list);
 	list_init(&ready_list);
 	list_init(&destruction_req);
@@ -132,6 +135,12 @@ void thread_init(void)
    Also creates the idle thread. */
 void thread_start(void)
 {
+#ifdef USERPROG
+	/* Needs malloc(), which thread_init() runs too early for. */
+	if (!child_table_init(&initial_thread->children))
+		PANIC("cannot allocate the child table of main");
+#endif
+
 	/* Create the idle thread. */
 	struct semaphore idle_started;
 	sema_init(&idle_started, 0);
@@ -204,13 +213,14 @@ tid_t thread_create(const char *name, int priority,
 	init_thread (t, name, priority);
 
 	/* file descriptor member init */
-	t->fdTable = palloc_get_multiple(PAL_ZERO, FDT_PAGES);
-	if (t->fdTable == NULL)
+#ifdef USERPROG
+	fd_table_init (&t->fdTable);
+	if (!child_table_init (&t->children))
+	{
+		palloc_free_page (t);
 		return TID_ERROR;
-	t->fdIdx = 2;
-
-	t->fdTable[0] = 1;
-	t->fdTable[1] = 2;  // 왜 1, 2일까?? 그저 dummy_value??
+	}
+#endif
 	t->stdin_count = 1;
 	t->stdout_count = 1;
 
@@ -218,10 +228,6 @@ tid_t thread_create(const char *name, int priority,
 
 	tid = t->tid = allocate_tid ();
 
-	/* syscall -> 부모의 child-list에 child t 추가 */
-	struct thread *curr = thread_current ();
-	list_push_back(&curr->child_list, &t->child_elem);
-
 	/* Call the kernel_thread if it scheduled.
 	 * Note) rdi is 1st argument, and rsi is 2nd argument. */
 	t->tf.rip = (uintptr_t)kernel_thread;
@@ -485,13 +491,11 @@ init_thread(struct thread *t, const char *name, int priority)
 	t->waiting_lock = NULL;
 	list_init(&t->donors);
 
-	// for syscall
-	list_init (&t->child_list);
-	sema_init(&t->wait_sema, 0);
-	sema_init(&t->fork_sema, 0);
-	sema_init(&t->free_sema, 0);
-
 	t->running = NULL;
+#ifdef VM
+	t->stack_limit = STACK_LIMIT_DEFAULT;
+	list_init (&t->frames);
+#endif
 }
 
 /* Chooses and returns the next thread to be scheduled.  Should
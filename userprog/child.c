@@ -0,0 +1,186 @@
+/* child.c: Exit records of child processes.
+
+   Each process keeps a record of every child process it creates with
+   fork() or spawn() in a hash table keyed by tid.  Kernel threads get
+   no record, even when started from a system call.  The record is all
+   that is left of a child once it exits: its thread, page tables and
+   descriptors are freed right away, whether or not the parent is
+   waiting, and the parent finds the exit status in the record later.  Exited children are also queued in exit
+   order, so waiting for any child takes the first of them without a
+   scan.
+
+   A record is freed by the parent once it has waited for the child, or
+   when the parent exits if the child is done by then, or else by the
+   child as it exits.  One lock guards all records, since a parent and a
+   child may both give up theirs at the same time. */
+
+#include "userprog/child.h"
+#include <debug.h>
+#include "threads/malloc.h"
+
+static struct lock children_lock;
+
+static uint64_t
+child_hash (const struct hash_elem *e, void *aux UNUSED) {
+	const struct child *c = hash_entry (e, struct child, elem);
+	return hash_int (c->tid);
+}
+
+static bool
+child_less (const struct hash_elem *a, const struct hash_elem *b,
+		void *aux UNUSED) {
+	return hash_entry (a, struct child, elem)->tid
+		< hash_entry (b, struct child, elem)->tid;
+}
+
+void
+child_init (void) {
+	lock_init (&children_lock);
+}
+
+/* Initializes TABLE, with no children. Returns false if memory is
+ * short. */
+bool
+child_table_init (struct child_table *table) {
+	list_init (&table->exited);
+	cond_init (&table->child_exited);
+	return hash_init (&table->children, child_hash, child_less, NULL);
+}
+
+/* Frees a record of a table being destroyed if the child is done with it,
+ * or leaves it to the child otherwise. */
+static void
+child_orphan (struct hash_elem *e, void *aux UNUSED) {
+	struct child *c = hash_entry (e, struct child, elem);
+
+	if (c->exited)
+		free (c);
+	else
+		c->table = NULL;
+}
+
+/* Destroys TABLE as its process exits. Children still running go on
+ * without a parent. */
+void
+child_table_destroy (struct child_table *table) {
+	lock_acquire (&children_lock);
+	hash_destroy (&table->children, child_orphan);
+	lock_release (&children_lock);
+}
+
+/* Returns a record for a child process about to be created, which
+ * will belong to TABLE once child_add() gives it a tid, or NULL if
+ * memory is short. The child's thread takes it over as its exit_rec. */
+struct child *
+child_create (struct child_table *table) {
+	struct child *c = malloc (sizeof *c);
+	if (c == NULL)
+		return NULL;
+
+	c->tid = -1;
+	c->status = -1;
+	c->exited = false;
+	c->start_failed = false;
+	sema_init (&c->started, 0);
+	c->table = table;
+	return c;
+}
+
+/* Adds C, the record of new child TID, to its table. Must be called
+ * by the parent before it waits for any child; the child may have
+ * exited already. */
+void
+child_add (struct child *c, int tid) {
+	lock_acquire (&children_lock);
+	c->tid = tid;
+	hash_insert (&c->table->children, &c->elem);
+	lock_release (&children_lock);
+}
+
+/* Frees C, a record whose child could not be created. */
+void
+child_discard (struct child *c) {
+	free (c);
+}
+
+/* Looks up child TID in TABLE with children_lock held. */
+static struct child *
+child_lookup (struct child_table *table, int tid) {
+	struct child key;
+	struct hash_elem *e;
+
+	key.tid = tid;
+	e = hash_find (&table->children, &key.elem);
+	return e != NULL ? hash_entry (e, struct child, elem) : NULL;
+}
+
+/* Tells the parent of child C, waiting on C->started, whether C was
+ * built. */
+void
+child_started (struct child *c, bool success) {
+	c->start_failed = !success;
+	sema_up (&c->started);
+}
+
+/* Records that child C exited with STATUS and wakes up its parent. C
+ * must not be used afterwards. */
+void
+child_exit (struct child *c, int status) {
+	lock_acquire (&children_lock);
+	c->status = status;
+	c->exited = true;
+	if (c->table == NULL)
+		free (c);
+	else {
+		list_push_back (&c->table->exited, &c->exit_elem);
+		cond_broadcast (&c->table->child_exited, &children_lock);
+	}
+	lock_release (&children_lock);
+}
+
+/* Waits for child TID in TABLE to exit, or for any child if TID is -1,
+ * and frees its record. Stores its exit status in *STATUS unless STATUS
+ * is null. Returns the child's tid, or -1 if there is no such child.
+ * With WNOHANG in OPTIONS, returns 0 instead of waiting if no such child
+ * has exited yet. */
+int
+child_wait (struct child_table *table, int tid, int *status, int options) {
+	struct child *c;
+
+	lock_acquire (&children_lock);
+	for (;;) {
+		if (tid == -1) {
+			if (hash_empty (&table->children))
+				goto fail;
+			c = list_empty (&table->exited) ? NULL
+				: list_entry (list_front (&table->exited), struct child,
+						exit_elem);
+		} else {
+			c = child_lookup (table, tid);
+			if (c == NULL)
+				goto fail;
+			if (!c->exited)
+				c = NULL;
+		}
+		if (c != NULL)
+			break;
+		if (options & WNOHANG) {
+			lock_release (&children_lock);
+			return 0;
+		}
+		cond_wait (&table->child_exited, &children_lock);
+	}
+
+	hash_delete (&table->children, &c->elem);
+	list_remove (&c->exit_elem);
+	lock_release (&children_lock);
+	if (status != NULL)
+		*status = c->status;
+	tid = c->tid;
+	free (c);
+	return tid;
+
+fail:
+	lock_release (&children_lock);
+	return -1;
+}
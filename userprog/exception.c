@@ -2,6 +2,7 @@
 #include <inttypes.h>
 #include <stdio.h>
 #include "userprog/gdt.h"
+#include "userprog/usercopy.h"
 #include "threads/interrupt.h"
 #include "threads/thread.h"
 #include "intrinsic.h"
@@ -151,6 +152,15 @@ page_fault (struct intr_frame *f) {
 	if (vm_try_handle_fault (f, fault_addr, user, write, not_present))
 		return;
 #endif
+
+	/* A user copy routine hit a bad user address: make it fail. */
+	if (!user) {
+		uintptr_t fixup = usercopy_fixup (f->rip);
+		if (fixup != 0) {
+			f->rip = fixup;
+			return;
+		}
+	}
 	
 	// if (user)
 	// {
@@ -0,0 +1,125 @@
+/* fdtable.c: File descriptor tables.
+
+   A table starts out with FD_INLINE slots inside the thread and grows
+   by doubling when a descriptor past its end is installed.  Allocation
+   always hands out the lowest free descriptor, found through the in-use
+   bitmap and its summary word without looking at the slots. */
+
+#include "userprog/fdtable.h"
+#include <string.h>
+#include "threads/malloc.h"
+
+/* Words of USED with descriptors in them. */
+#define FD_WORDS_MASK ((FD_WORDS < 64 ? (1ULL << FD_WORDS) : 0) - 1)
+
+/* Initializes TABLE with the console on descriptors 0 and 1. */
+void
+fd_table_init (struct fd_table *table) {
+	memset (table, 0, sizeof *table);
+	table->files = table->files_inline;
+	table->cap = FD_INLINE;
+	fd_table_install (table, 0, (struct file *) 1);
+	fd_table_install (table, 1, (struct file *) 2);
+}
+
+/* Frees the slots of TABLE. The files in it are left alone. */
+void
+fd_table_destroy (struct fd_table *table) {
+	if (table->files != table->files_inline)
+		free (table->files);
+	table->files = table->files_inline;
+	table->cap = FD_INLINE;
+}
+
+/* Returns what FD refers to in TABLE, or NULL if it is not open. */
+struct file *
+fd_table_get (const struct fd_table *table, int fd) {
+	if (fd < 0 || fd >= table->cap)
+		return NULL;
+	return table->files[fd];
+}
+
+/* Grows TABLE to hold at least FD + 1 slots. */
+static bool
+fd_table_grow (struct fd_table *table, int fd) {
+	int cap = table->cap;
+
+	while (cap <= fd)
+		cap *= 2;
+	if (cap > FDCOUNT_LIMIT)
+		cap = FDCOUNT_LIMIT;
+
+	struct file **files = malloc (cap * sizeof *files);
+	if (files == NULL)
+		return false;
+	memcpy (files, table->files, table->cap * sizeof *files);
+	memset (files + table->cap, 0, (cap - table->cap) * sizeof *files);
+	if (table->files != table->files_inline)
+		free (table->files);
+	table->files = files;
+	table->cap = cap;
+	return true;
+}
+
+/* Makes FD refer to FILE in TABLE, replacing whatever it referred to.
+ * Returns false if FD is out of range or memory is short. */
+bool
+fd_table_install (struct fd_table *table, int fd, struct file *file) {
+	if (fd < 0 || fd >= FDCOUNT_LIMIT)
+		return false;
+	if (fd >= table->cap && !fd_table_grow (table, fd))
+		return false;
+
+	int w = fd / 64;
+	table->files[fd] = file;
+	table->used[w] |= 1ULL << (fd % 64);
+	if (table->used[w] == UINT64_MAX)
+		table->full |= 1ULL << w;
+	return true;
+}
+
+/* Makes the lowest free descriptor of TABLE refer to FILE. Returns the
+ * descriptor, or -1 if the table is full or memory is short. */
+int
+fd_table_alloc (struct fd_table *table, struct file *file) {
+	uint64_t free_words = ~table->full & FD_WORDS_MASK;
+
+	if (free_words == 0)
+		return -1;
+	int w = __builtin_ctzll (free_words);
+	int fd = w * 64 + __builtin_ctzll (~table->used[w]);
+	return fd_table_install (table, fd, file) ? fd : -1;
+}
+
+/* Frees descriptor FD of TABLE. */
+void
+fd_table_clear (struct fd_table *table, int fd) {
+	if (fd < 0 || fd >= table->cap)
+		return;
+
+	int w = fd / 64;
+	table->files[fd] = NULL;
+	table->used[w] &= ~(1ULL << (fd % 64));
+	table->full &= ~(1ULL << w);
+}
+
+/* Returns the lowest descriptor of TABLE in use above FD, or -1. Start
+ * with FD = -1 to walk every open descriptor. */
+int
+fd_table_next (const struct fd_table *table, int fd) {
+	fd++;
+	for (int w = fd / 64; w < FD_WORDS && w * 64 < table->cap; w++) {
+		uint64_t bits = table->used[w];
+		if (w == fd / 64)
+			bits &= UINT64_MAX << (fd % 64);
+		if (bits != 0)
+			return w * 64 + __builtin_ctzll (bits);
+	}
+	return -1;
+}
+
+/* Returns true if every descriptor of TABLE is in use. */
+bool
+fd_table_full (const struct fd_table *table) {
+	return (table->full & FD_WORDS_MASK) == FD_WORDS_MASK;
+}
@@ -0,0 +1,417 @@
+/* ioring.c: Asynchronous file I/O through rings in user memory.
+
+   ioring_setup() maps a submission queue and a completion queue into the
+   process.  The process fills in requests and hands any number of them
+   over with one ioring_enter(), which also waits for completions if
+   asked to.  Requests run on a pool of kernel threads, so the process
+   keeps computing, and can keep many requests in flight, while they
+   wait for the disk.
+
+   The workers never touch user memory.  Entries are read, and data is
+   copied in and out, by ioring_enter() in the context of the process,
+   so user pages need not be pinned while requests are in flight and
+   stay free to be evicted or unmapped.  The price is that completions
+   show up in the ring only when the process enters the kernel. */
+
+#include "userprog/ioring.h"
+#include <list.h>
+#include <round.h>
+#include <string.h>
+#include "filesys/file.h"
+#include "filesys/filesys.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "userprog/syscall.h"
+#include "userprog/usercopy.h"
+#include "vm/vm.h"
+
+/* Kernel threads that run requests. */
+#define IORING_WORKERS 4
+
+/* Kernel side of a process's ring. */
+struct ioring {
+	struct io_ring *uring;  /* Head of the ring in user memory. */
+	unsigned entries;       /* Submission queue entries. */
+	unsigned sq_head;       /* Next request to take. */
+	unsigned cq_tail;       /* Next completion to post. */
+	unsigned inflight;      /* Requests taken but not posted yet. */
+	unsigned running;       /* Requests handed to the workers. */
+
+	struct lock lock;       /* Guards RUNNING and DONE. */
+	struct condition done_cond;
+	struct list done;       /* Finished requests, not posted yet. */
+};
+
+/* A request on its way through the kernel. */
+struct ioring_op {
+	struct list_elem elem;  /* On the work queue or RING's DONE list. */
+	struct ioring *ring;
+	struct io_sqe sqe;
+	struct file *file;      /* Own handle to the file, or opened file. */
+	void *kbuf;             /* Kernel copy of the data or file name. */
+	int res;
+};
+
+static struct list work_queue;
+static struct lock work_lock;
+static struct condition work_cond;
+
+static void ioring_worker (void *aux);
+
+void
+ioring_init (void) {
+	list_init (&work_queue);
+	lock_init (&work_lock);
+	cond_init (&work_cond);
+}
+
+/* Starts the workers. Called once at boot, once threads can be created,
+ * so that the workers belong to the kernel rather than to whichever
+ * process sets up the first ring. */
+void
+ioring_start (void) {
+	for (int i = 0; i < IORING_WORKERS; i++)
+		if (thread_create ("ioring", PRI_DEFAULT, ioring_worker, NULL)
+				== TID_ERROR)
+			PANIC ("cannot start the ioring workers");
+}
+
+/* Zero-fills a page of a ring. */
+static bool
+ioring_zero_page (struct page *page, void *aux UNUSED) {
+	memset (page->frame->kva, 0, PGSIZE);
+	return true;
+}
+
+/* Maps a ring with ENTRIES submission entries at ADDR, a page boundary,
+ * and returns ADDR, or NULL if ENTRIES is not a power of two up to
+ * IORING_ENTRIES_MAX, the pages are in use or the process already has a
+ * ring. The ring lasts as long as the address space. */
+void *
+ioring_setup (void *addr, unsigned entries) {
+	struct thread *curr = thread_current ();
+	struct supplemental_page_table *spt = &curr->spt;
+
+	if (curr->ioring != NULL || entries == 0
+			|| entries > IORING_ENTRIES_MAX || (entries & (entries - 1)))
+		return NULL;
+	void *end = addr + ROUND_UP (IORING_SIZE (entries), PGSIZE);
+	if (addr == NULL || pg_ofs (addr) != 0 || !is_user_vaddr (end - 1)
+			|| vm_stack_reserved (addr, end))
+		return NULL;
+
+	struct ioring *ring = malloc (sizeof *ring);
+	if (ring == NULL)
+		return NULL;
+
+	rwlock_acquire_write (&spt->lock);
+	bool ok = spt_range_free (spt, addr, end);
+	void *va;
+	for (va = addr; ok && va < end; va += PGSIZE)
+		ok = vm_alloc_page_with_initializer (VM_ANON, va, true,
+				ioring_zero_page, NULL);
+	if (!ok)
+		while (va > addr) {
+			va -= PGSIZE;
+			struct page *page = spt_find_page (spt, va);
+			if (page != NULL)
+				spt_remove_page (spt, page);
+		}
+	rwlock_release_write (&spt->lock);
+	if (!ok) {
+		free (ring);
+		return NULL;
+	}
+
+	struct io_ring head = {
+		.sq_mask = entries - 1,
+		.sq_entries = entries,
+		.cq_mask = 2 * entries - 1,
+		.cq_entries = 2 * entries,
+		.sqes = addr + sizeof head,
+		.cqes = addr + sizeof head + entries * sizeof (struct io_sqe),
+	};
+	if (copy_to_user (addr, &head, sizeof head) != 0) {
+		free (ring);
+		return NULL;
+	}
+
+	ring->uring = addr;
+	ring->entries = entries;
+	ring->sq_head = 0;
+	ring->cq_tail = 0;
+	ring->inflight = 0;
+	ring->running = 0;
+	lock_init (&ring->lock);
+	cond_init (&ring->done_cond);
+	list_init (&ring->done);
+	curr->ioring = ring;
+	return addr;
+}
+
+/* Where the queues of RING are in user memory. The copies of these in
+ * the head of the ring are for the process only. */
+static struct io_sqe *
+ioring_sqes (struct ioring *ring) {
+	return (struct io_sqe *) (ring->uring + 1);
+}
+
+static struct io_cqe *
+ioring_cqes (struct ioring *ring) {
+	return (struct io_cqe *) (ioring_sqes (ring) + ring->entries);
+}
+
+/* Frees OP and whatever it still holds. */
+static void
+ioring_op_free (struct ioring_op *op) {
+	file_close (op->file);
+	if (op->sqe.opcode == IORING_OP_OPEN)
+		palloc_free_page (op->kbuf);
+	else
+		free (op->kbuf);
+	free (op);
+}
+
+/* Gathers what OP needs from the process, so that a worker can run it.
+ * Returns false if OP fails right away. */
+static bool
+ioring_prepare (struct ioring_op *op) {
+	struct io_sqe *sqe = &op->sqe;
+	struct file *file;
+
+	switch (sqe->opcode) {
+		case IORING_OP_NOP:
+			return true;
+
+		case IORING_OP_READ:
+		case IORING_OP_WRITE:
+		case IORING_OP_FSYNC:
+			file = get_seekable_file (sqe->fd);
+			if (file == NULL || sqe->offset < 0)
+				return false;
+			op->file = file_reopen (file);
+			if (op->file == NULL || sqe->opcode == IORING_OP_FSYNC)
+				return op->file != NULL;
+
+			sqe->len = MIN (sqe->len, IORING_IO_MAX);
+			if (sqe->len == 0)
+				return true;
+			op->kbuf = malloc (sqe->len);
+			if (op->kbuf == NULL)
+				return false;
+			return sqe->opcode == IORING_OP_READ
+				|| copy_from_user (op->kbuf, sqe->buf, sqe->len) == 0;
+
+		case IORING_OP_OPEN:
+			op->kbuf = palloc_get_page (0);
+			if (op->kbuf == NULL)
+				return false;
+			int len = strncpy_from_user (op->kbuf, sqe->buf, PGSIZE);
+			return len >= 0 && len < PGSIZE;
+
+		default:
+			return false;
+	}
+}
+
+/* Takes up to TO_SUBMIT requests off the submission queue of RING,
+ * leaving room in the completion queue for every request in flight.
+ * Returns the number taken, or -1 if the ring is not readable. */
+static int
+ioring_submit (struct ioring *ring, unsigned to_submit) {
+	struct io_ring *uring = ring->uring;
+	unsigned sq_tail;
+	int submitted = 0;
+
+	if (copy_from_user (&sq_tail, &uring->sq_tail, sizeof sq_tail) != 0)
+		return -1;
+	to_submit = MIN (to_submit, sq_tail - ring->sq_head);
+	to_submit = MIN (to_submit, ring->entries);
+	to_submit = MIN (to_submit, 2 * ring->entries - ring->inflight);
+
+	for (; to_submit > 0; to_submit--) {
+		struct ioring_op *op = calloc (1, sizeof *op);
+		if (op == NULL)
+			break;
+		unsigned idx = ring->sq_head & (ring->entries - 1);
+		if (copy_from_user (&op->sqe, &ioring_sqes (ring)[idx],
+					sizeof op->sqe) != 0) {
+			free (op);
+			return -1;
+		}
+		ring->sq_head++;
+		ring->inflight++;
+		submitted++;
+		op->ring = ring;
+		op->res = -1;
+
+		if (!ioring_prepare (op)) {
+			lock_acquire (&ring->lock);
+			list_push_back (&ring->done, &op->elem);
+			lock_release (&ring->lock);
+			continue;
+		}
+		lock_acquire (&ring->lock);
+		ring->running++;
+		lock_release (&ring->lock);
+
+		lock_acquire (&work_lock);
+		list_push_back (&work_queue, &op->elem);
+		cond_signal (&work_cond, &work_lock);
+		lock_release (&work_lock);
+	}
+
+	copy_to_user (&uring->sq_head, &ring->sq_head, sizeof ring->sq_head);
+	return submitted;
+}
+
+/* Returns how many completions of RING the process has not consumed. */
+static unsigned
+ioring_cq_ready (struct ioring *ring) {
+	unsigned cq_head;
+
+	if (copy_from_user (&cq_head, &ring->uring->cq_head, sizeof cq_head) != 0)
+		return 2 * ring->entries;
+	return MIN (ring->cq_tail - cq_head, 2 * ring->entries);
+}
+
+/* Posts finished requests of RING to its completion queue, as many as
+ * fit, copying read data out and installing opened files. */
+static void
+ioring_reap (struct ioring *ring) {
+	struct io_ring *uring = ring->uring;
+	unsigned room = 2 * ring->entries - ioring_cq_ready (ring);
+	bool posted = false;
+
+	for (; room > 0; room--) {
+		lock_acquire (&ring->lock);
+		struct ioring_op *op = list_empty (&ring->done) ? NULL
+			: list_entry (list_pop_front (&ring->done), struct ioring_op, elem);
+		lock_release (&ring->lock);
+		if (op == NULL)
+			break;
+
+		if (op->sqe.opcode == IORING_OP_READ && op->res > 0
+				&& copy_to_user (op->sqe.buf, op->kbuf, op->res) != 0)
+			op->res = -1;
+		if (op->sqe.opcode == IORING_OP_OPEN && op->file != NULL) {
+			op->res = process_add_file (op->file);
+			if (op->res != -1)
+				op->file = NULL;
+		}
+
+		struct io_cqe cqe = { .user_data = op->sqe.user_data, .res = op->res };
+		unsigned idx = ring->cq_tail & (2 * ring->entries - 1);
+		copy_to_user (&ioring_cqes (ring)[idx], &cqe, sizeof cqe);
+		ring->cq_tail++;
+		ring->inflight--;
+		posted = true;
+		ioring_op_free (op);
+	}
+
+	if (posted)
+		copy_to_user (&uring->cq_tail, &ring->cq_tail, sizeof ring->cq_tail);
+}
+
+/* Submits up to TO_SUBMIT requests from the current process's ring,
+ * then waits until MIN_COMPLETE completions are ready in it or nothing
+ * more is in flight. Returns the number of requests submitted, or -1 if
+ * the process has no ring. */
+int
+ioring_enter (unsigned to_submit, unsigned min_complete) {
+	struct ioring *ring = thread_current ()->ioring;
+
+	if (ring == NULL)
+		return -1;
+	int submitted = ioring_submit (ring, to_submit);
+	min_complete = MIN (min_complete, 2 * ring->entries);
+
+	for (;;) {
+		ioring_reap (ring);
+		if (ioring_cq_ready (ring) >= min_complete || ring->inflight == 0)
+			break;
+
+		/* The queue has room, so nothing is left done; wait for more. */
+		lock_acquire (&ring->lock);
+		while (list_empty (&ring->done))
+			cond_wait (&ring->done_cond, &ring->lock);
+		lock_release (&ring->lock);
+	}
+	return submitted;
+}
+
+/* Waits for the requests of the current process's ring to finish and
+ * frees the ring. Its pages go with the address space. */
+void
+ioring_destroy (void) {
+	struct thread *curr = thread_current ();
+	struct ioring *ring = curr->ioring;
+
+	if (ring == NULL)
+		return;
+
+	lock_acquire (&ring->lock);
+	while (ring->running > 0)
+		cond_wait (&ring->done_cond, &ring->lock);
+	lock_release (&ring->lock);
+
+	while (!list_empty (&ring->done))
+		ioring_op_free (list_entry (list_pop_front (&ring->done),
+					struct ioring_op, elem));
+	free (ring);
+	curr->ioring = NULL;
+}
+
+/* Runs OP. The file system is not safe to enter from several threads at
+ * once, so each request holds filesys_lock like the system calls do. */
+static void
+ioring_execute (struct ioring_op *op) {
+	struct io_sqe *sqe = &op->sqe;
+
+	lock_acquire (&filesys_lock);
+	switch (sqe->opcode) {
+		case IORING_OP_READ:
+			op->res = file_read_at (op->file, op->kbuf, sqe->len, sqe->offset);
+			break;
+		case IORING_OP_WRITE:
+			op->res = file_write_at (op->file, op->kbuf, sqe->len, sqe->offset);
+			break;
+		case IORING_OP_FSYNC:
+			/* Writes go straight to the disk, so earlier ones are there. */
+			op->res = 0;
+			break;
+		case IORING_OP_OPEN:
+			op->file = filesys_open (op->kbuf);
+			op->res = op->file != NULL ? 0 : -1;
+			break;
+		default:
+			op->res = 0;
+			break;
+	}
+	lock_release (&filesys_lock);
+}
+
+/* Runs requests from the work queue, forever. */
+static void
+ioring_worker (void *aux UNUSED) {
+	for (;;) {
+		lock_acquire (&work_lock);
+		while (list_empty (&work_queue))
+			cond_wait (&work_cond, &work_lock);
+		struct ioring_op *op = list_entry (list_pop_front (&work_queue),
+				struct ioring_op, elem);
+		lock_release (&work_lock);
+
+		ioring_execute (op);
+
+		struct ioring *ring = op->ring;
+		lock_acquire (&ring->lock);
+		list_push_back (&ring->done, &op->elem);
+		ring->running--;
+		cond_broadcast (&ring->done_cond, &ring->lock);
+		lock_release (&ring->lock);
+	}
+}
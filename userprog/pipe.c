@@ -0,0 +1,207 @@
+/* pipe.c: Anonymous pipes.
+
+   A pipe is a ring buffer of PIPE_SIZE bytes with free-running head and
+   tail indexes, so that it is empty when they are equal and full when
+   they are PIPE_SIZE apart.  Readers block while it is empty and writers
+   while it is full.  Each end is a struct file, so the ends are shared
+   through dup2() and inherited across fork() like any other file.
+
+   A write of a page or more to an empty pipe skips the ring.  The writer
+   lends the reader its own pages, which the write system call has
+   pinned, and waits until the reader has copied straight out of them,
+   so the data is copied once rather than twice. */
+
+#include "userprog/pipe.h"
+#include <stdint.h>
+#include <string.h>
+#include "filesys/file.h"
+#include "threads/malloc.h"
+#include "threads/mmu.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+
+/* Most pages of a writer lent at once. */
+#define PIPE_LOAN_PAGES 16
+
+/* Pages of a blocked writer that a reader copies from. */
+struct pipe_loan {
+	uint8_t *pages[PIPE_LOAN_PAGES];  /* Kernel addresses of the pages. */
+	unsigned ofs;           /* Where the data starts in PAGES[0]. */
+	unsigned size;          /* Bytes lent. */
+	unsigned taken;         /* Bytes copied out so far. */
+};
+
+struct pipe {
+	struct lock lock;
+	struct condition readable;  /* Data, a loan or the writer gone. */
+	struct condition writable;  /* Room, a loan taken or the reader gone. */
+	uint8_t *buf;               /* PIPE_SIZE bytes. */
+	unsigned head, tail;        /* Next byte to read, to write. */
+	struct pipe_loan *loan;     /* Pages lent by the writer, or NULL. */
+	bool reader_open, writer_open;
+};
+
+/* Creates a pipe and stores files for its two ends in *READER and
+ * *WRITER. Returns false if memory is short. */
+bool
+pipe_create (struct file **reader, struct file **writer) {
+	struct pipe *pipe = malloc (sizeof *pipe);
+	if (pipe == NULL)
+		return false;
+	pipe->buf = palloc_get_page (0);
+	if (pipe->buf == NULL) {
+		free (pipe);
+		return false;
+	}
+	lock_init (&pipe->lock);
+	cond_init (&pipe->readable);
+	cond_init (&pipe->writable);
+	pipe->head = pipe->tail = 0;
+	pipe->loan = NULL;
+	pipe->reader_open = pipe->writer_open = true;
+
+	*reader = file_open_pipe (pipe, false);
+	if (*reader == NULL) {
+		palloc_free_page (pipe->buf);
+		free (pipe);
+		return false;
+	}
+	*writer = file_open_pipe (pipe, true);
+	if (*writer == NULL) {
+		pipe->writer_open = false;
+		file_close (*reader);
+		return false;
+	}
+	return true;
+}
+
+/* Reads up to SIZE bytes from PIPE into BUFFER, waiting until there is
+ * something to read. Returns the number of bytes read, which is 0 only
+ * once the writing end is closed and the pipe is empty. */
+int
+pipe_read (struct pipe *pipe, void *buffer_, unsigned size) {
+	uint8_t *buffer = buffer_;
+	unsigned n = 0;
+
+	if (size == 0)
+		return 0;
+
+	lock_acquire (&pipe->lock);
+	while (pipe->head == pipe->tail && pipe->loan == NULL
+			&& pipe->writer_open)
+		cond_wait (&pipe->readable, &pipe->lock);
+
+	if (pipe->head != pipe->tail) {
+		n = MIN (size, pipe->tail - pipe->head);
+		for (unsigned i = 0; i < n; ) {
+			unsigned ofs = (pipe->head + i) % PIPE_SIZE;
+			unsigned chunk = MIN (n - i, PIPE_SIZE - ofs);
+			memcpy (buffer + i, pipe->buf + ofs, chunk);
+			i += chunk;
+		}
+		pipe->head += n;
+	} else if (pipe->loan != NULL) {
+		struct pipe_loan *loan = pipe->loan;
+		while (n < size && loan->taken < loan->size) {
+			unsigned pos = loan->ofs + loan->taken;
+			unsigned chunk = MIN (size - n, loan->size - loan->taken);
+			chunk = MIN (chunk, PGSIZE - pos % PGSIZE);
+			memcpy (buffer + n, loan->pages[pos / PGSIZE] + pos % PGSIZE,
+					chunk);
+			n += chunk;
+			loan->taken += chunk;
+		}
+	}
+	if (n > 0)
+		cond_broadcast (&pipe->writable, &pipe->lock);
+	lock_release (&pipe->lock);
+	return n;
+}
+
+/* Fills in LOAN with the pages of the current process holding the SIZE
+ * bytes at BUFFER, or as many of them as fit. Returns false if a page is
+ * not present. */
+static bool
+pipe_lend (struct pipe_loan *loan, const uint8_t *buffer, unsigned size) {
+	uint64_t *pml4 = thread_current ()->pml4;
+	const uint8_t *base = pg_round_down (buffer);
+
+	loan->ofs = pg_ofs (buffer);
+	loan->size = MIN (size, PIPE_LOAN_PAGES * PGSIZE - loan->ofs);
+	loan->taken = 0;
+	for (unsigned i = 0; i * PGSIZE < loan->ofs + loan->size; i++) {
+		loan->pages[i] = pml4_get_page (pml4, base + i * PGSIZE);
+		if (loan->pages[i] == NULL)
+			return false;
+	}
+	return true;
+}
+
+/* Writes SIZE bytes from BUFFER to PIPE, waiting for room as needed.
+ * BUFFER must be pinned. Returns the number of bytes written, which is
+ * short only if the reading end is closed, or -1 if it was closed
+ * before anything was written. */
+int
+pipe_write (struct pipe *pipe, const void *buffer_, unsigned size) {
+	const uint8_t *buffer = buffer_;
+	unsigned n = 0;
+
+	lock_acquire (&pipe->lock);
+	while (n < size && pipe->reader_open) {
+		struct pipe_loan loan;
+
+		if (pipe->loan != NULL || pipe->tail - pipe->head == PIPE_SIZE) {
+			cond_wait (&pipe->writable, &pipe->lock);
+			continue;
+		}
+
+		if (size - n >= PGSIZE && pipe->head == pipe->tail
+				&& pipe_lend (&loan, buffer + n, size - n)) {
+			pipe->loan = &loan;
+			cond_broadcast (&pipe->readable, &pipe->lock);
+			while (loan.taken < loan.size && pipe->reader_open)
+				cond_wait (&pipe->writable, &pipe->lock);
+			pipe->loan = NULL;
+			n += loan.taken;
+			cond_broadcast (&pipe->writable, &pipe->lock);
+			continue;
+		}
+
+		unsigned chunk = MIN (size - n, PIPE_SIZE - (pipe->tail - pipe->head));
+		for (unsigned i = 0; i < chunk; ) {
+			unsigned ofs = (pipe->tail + i) % PIPE_SIZE;
+			unsigned part = MIN (chunk - i, PIPE_SIZE - ofs);
+			memcpy (pipe->buf + ofs, buffer + n + i, part);
+			i += part;
+		}
+		pipe->tail += chunk;
+		n += chunk;
+		cond_broadcast (&pipe->readable, &pipe->lock);
+	}
+	lock_release (&pipe->lock);
+	return n > 0 || size == 0 ? (int) n : -1;
+}
+
+/* Closes the reading end of PIPE, or its writing end if WRITER, and
+ * frees PIPE once both are closed. */
+void
+pipe_close (struct pipe *pipe, bool writer) {
+	bool dead;
+
+	lock_acquire (&pipe->lock);
+	if (writer)
+		pipe->writer_open = false;
+	else
+		pipe->reader_open = false;
+	cond_broadcast (&pipe->readable, &pipe->lock);
+	cond_broadcast (&pipe->writable, &pipe->lock);
+	dead = !pipe->reader_open && !pipe->writer_open;
+	lock_release (&pipe->lock);
+
+	if (dead) {
+		palloc_free_page (pipe->buf);
+		free (pipe);
+	}
+}
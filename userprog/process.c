@@ -5,7 +5,10 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include "userprog/child.h"
 #include "userprog/gdt.h"
+#include "userprog/ioring.h"
+#include "userprog/syscall.h"
 #include "userprog/tss.h"
 #include "filesys/directory.h"
 #include "filesys/file.h"
@@ -13,6 +16,7 @@
 #include "threads/flags.h"
 #include "threads/init.h"
 #include "threads/interrupt.h"
+#include "threads/malloc.h"
 #include "threads/palloc.h"
 #include "threads/thread.h"
 #include "threads/mmu.h"
@@ -20,12 +24,16 @@
 #include "intrinsic.h"
 #ifdef VM
 #include "vm/vm.h"
+#include "vm/fcache.h"
 #endif
 
 static void process_cleanup (void);
 static bool load (const char *file_name, struct intr_frame *if_);
+static bool load_argv (const char *path, char **argv, int argc,
+		struct intr_frame *if_);
 static void initd (void *f_name);
 static void __do_fork (void *);
+static void spawn_child (void *);
 
 
 /* General process initializer for initd and other process. */
@@ -34,6 +42,12 @@ process_init (void) {
 	struct thread *current = thread_current ();
 }
 
+/* What initd takes from process_create_initd(). */
+struct initd_args {
+	char *file_name;
+	struct child *rec;          /* Exit record in the creator's table. */
+};
+
 /* Starts the first userland program, called "initd", loaded from FILE_NAME.
  * The new thread may be scheduled (and may even exit)
  * before process_create_initd() returns. Returns the initd's
@@ -51,19 +65,43 @@ process_create_initd (const char *file_name) {
 		return TID_ERROR;
 	strlcpy (fn_copy, file_name, PGSIZE);
 
+	struct initd_args *args = malloc (sizeof *args);
+	if (args == NULL) {
+		palloc_free_page (fn_copy);
+		return TID_ERROR;
+	}
+	args->file_name = fn_copy;
+	args->rec = child_create (&thread_current ()->children);
+	if (args->rec == NULL) {
+		free (args);
+		palloc_free_page (fn_copy);
+		return TID_ERROR;
+	}
+
 	char *save_ptr;
 	strtok_r(file_name, " ", &save_ptr);
 
 	/* Create a new thread to execute FILE_NAME. */
-	tid = thread_create (file_name, PRI_DEFAULT, initd, fn_copy);
-	if (tid == TID_ERROR)
+	struct child *rec = args->rec;
+	tid = thread_create (file_name, PRI_DEFAULT, initd, args);
+	if (tid == TID_ERROR) {
+		child_discard (rec);
+		free (args);
 		palloc_free_page (fn_copy);
+		return TID_ERROR;
+	}
+	child_add (rec, tid);
 	return tid;
 }
 
 /* A thread function that launches first user process. */
 static void
-initd (void *f_name) {
+initd (void *args_) {
+	struct initd_args *args = args_;
+	char *f_name = args->file_name;
+
+	thread_current ()->exit_rec = args->rec;
+	free (args);
 #ifdef VM
 	supplemental_page_table_init (&thread_current ()->spt);
 #endif
@@ -73,22 +111,40 @@ initd (void *f_name) {
 	NOT_REACHED ();
 }
 
+/* What a forked child takes from its parent. The parent waits on the
+ * child's record until the child is done with it. */
+struct fork_args {
+	struct thread *parent;
+	struct child *rec;          /* Exit record in the parent's table. */
+};
+
 /* Clones the current process as `name`. Returns the new process's thread id, or
  * TID_ERROR if the thread cannot be created. */
 tid_t
 process_fork (const char *name, struct intr_frame *if_) {
 	/* Clone current thread to new thread.*/
 	struct thread *cur = thread_current ();
+	struct fork_args args = {
+		.parent = cur,
+		.rec = child_create (&cur->children),
+	};
+	if (args.rec == NULL)
+		return TID_ERROR;
 	memcpy(&cur->parent_if, if_, sizeof(struct intr_frame));
-	tid_t tid = thread_create (name, PRI_DEFAULT, __do_fork, cur);
-	if(tid == TID_ERROR)
+	tid_t tid = thread_create (name, PRI_DEFAULT, __do_fork, &args);
+	if(tid == TID_ERROR) {
+		child_discard (args.rec);
 		return TID_ERROR;
+	}
+	child_add (args.rec, tid);
 
-	struct thread *child = get_child_with_pid(tid);
-	sema_down(&child->fork_sema);
-	if (child->exit_status == -1)
+	struct child *child = args.rec;
+	sema_down (&child->started);
+	if (child->start_failed) {
+		/* Reap it, so that its record does not linger. */
+		process_wait (tid);
 		return TID_ERROR;
-	
+	}
 	return tid;
 }
 
@@ -142,21 +198,18 @@ duplicate_pte (uint64_t *pte, void *va, void *aux)
  * Hint) parent->tf does not hold the userland context of the process.
  *       That is, you are required to pass second argument of process_fork to
  *       this function. */
-struct MapElem
-{
-	uintptr_t key;
-	uintptr_t value;
-};
-
 static void
 __do_fork (void *aux)
 {
 	struct intr_frame if_;
-	struct thread *parent = (struct thread *) aux;
+	struct fork_args *args = aux;
+	struct thread *parent = args->parent;
 	struct thread *current = thread_current ();
 	/* TODO: somehow pass the parent_if. (i.e. process_fork()'s if_) */
 	struct intr_frame *parent_if = &parent->parent_if;
 	bool succ = true;
+
+	current->exit_rec = args->rec;
 	
 	/* 1. Read the cpu context to local stack. */
 	memcpy (&if_, parent_if, sizeof (struct intr_frame));
@@ -170,6 +223,9 @@ __do_fork (void *aux)
 	
 	process_activate (current);
 #ifdef VM
+	current->stack_limit = parent->stack_limit;
+	current->rss_limit = parent->rss_limit;
+	current->rss_min = parent->rss_min;
 	supplemental_page_table_init (&current->spt);
 	if (!supplemental_page_table_copy (&current->spt, &parent->spt))
 		goto error;
@@ -184,56 +240,30 @@ __do_fork (void *aux)
 	 * TODO:       from the fork() until this function successfully duplicates
 	 * TODO:       the resources of parent.*/
 
-	if (parent->fdIdx == FDCOUNT_LIMIT)
+	if (fd_table_full (&parent->fdTable))
 		goto error;
 
-	/*        자식 프로세스에 부모프로세스 파일 복사       */
-	const int MAPLEN = 10;
-	struct MapElem map[10]; // key - parent's struct file * , value - child's newly created struct file *
-	int dupCount = 0;		// index for filling map
-
-	for (int i = 0; i < FDCOUNT_LIMIT; i++)
+	/* The child's descriptors share the parent's open files, so a read
+	 * or seek through one moves the position seen by the other. */
+	for (int i = fd_table_next (&parent->fdTable, -1); i >= 0;
+			i = fd_table_next (&parent->fdTable, i))
 	{
-		struct file *file = parent->fdTable[i];
-		if (file == NULL)
-			continue;
-
-		// Project2-extra) linear search on key-pair array
-		// If 'file' is already duplicated in child, don't duplicate again but share it
-		bool found = false;
-		for (int j = 0; j < MAPLEN; j++)
-		{
-			if (map[j].key == file)
-			{
-				found = true;
-				current->fdTable[i] = map[j].value;
-				break;
-			}
-		}
-		if (!found)
-		{
-			struct file *new_file;
-			if (file > 2)
-				new_file = file_duplicate(file);
-			else
-				new_file = file; // 1 STDIN, 2 STDOUT
-
-			current->fdTable[i] = new_file;
-			if (dupCount < MAPLEN)
-			{
-				map[dupCount].key = file;
-				map[dupCount].value = new_file;
-				dupCount++;
-			}
+		struct file *file = fd_table_get (&parent->fdTable, i);
+
+		if ((uintptr_t) file > 2)
+			file_dup (file);
+		if (!fd_table_install (&current->fdTable, i, file)) {
+			if ((uintptr_t) file > 2)
+				file_close (file);
+			goto error;
 		}
 	}
-	current->fdIdx = parent->fdIdx;
 	
 	/*      왜있는걸까 나중에 추가될지도  ???*/
 	process_init ();
 	
 	// 부모 프로세스 깨워줘야됨 이제
-	sema_up(&current->fork_sema);
+	child_started (current->exit_rec, true);
 	
 
 	/* Finally, switch to the newly created process. */
@@ -245,11 +275,151 @@ __do_fork (void *aux)
 
 /* 비정상적인 종료 */
 error:
-	current->exit_status = TID_ERROR;
-	sema_up(&current->fork_sema);
+	child_started (current->exit_rec, false);
 	exit(TID_ERROR);
 }
 
+/* What a spawned child takes from its parent. The parent waits on the
+ * child's record until the child is done with it. */
+struct spawn_args {
+	struct thread *parent;
+	struct child *rec;          /* Exit record in the parent's table. */
+	const char *path;
+	char **argv;
+	int argc;
+	const struct spawn_action *actions;
+	size_t action_cnt;
+};
+
+/* Starts the executable PATH as a new child process with the ARGC
+ * arguments in ARGV. Unlike fork() and exec(), the child is built from
+ * the file alone and none of the parent's memory is copied. The child
+ * inherits the parent's descriptors, changed by the ACTION_CNT entries
+ * of ACTIONS in order, and its resource limits. Returns the child's
+ * thread id, or TID_ERROR if it could not be started. */
+tid_t
+process_spawn (const char *path, char **argv, int argc,
+		const struct spawn_action *actions, size_t action_cnt) {
+	struct spawn_args args = {
+		.parent = thread_current (),
+		.path = path,
+		.argv = argv,
+		.argc = argc,
+		.actions = actions,
+		.action_cnt = action_cnt,
+		.rec = child_create (&thread_current ()->children),
+	};
+	if (args.rec == NULL)
+		return TID_ERROR;
+
+	tid_t tid = thread_create (path, PRI_DEFAULT, spawn_child, &args);
+	if (tid == TID_ERROR) {
+		child_discard (args.rec);
+		return TID_ERROR;
+	}
+	child_add (args.rec, tid);
+
+	struct child *child = args.rec;
+	sema_down (&child->started);
+	if (child->start_failed) {
+		/* Reap it, so that its record does not linger. */
+		process_wait (tid);
+		return TID_ERROR;
+	}
+	return tid;
+}
+
+/* Gives CHILD the descriptors of PARENT, changed by the ACTION_CNT
+ * entries of ACTIONS. Files left open are shared with the parent, as
+ * they are across fork(). */
+static bool
+spawn_inherit_files (struct thread *child, struct thread *parent,
+		const struct spawn_action *actions, size_t action_cnt) {
+	struct fd_table src;
+	bool success = false;
+
+	/* Work out what each descriptor ends up referring to first. */
+	fd_table_init (&src);
+	for (int fd = fd_table_next (&parent->fdTable, -1); fd >= 0;
+			fd = fd_table_next (&parent->fdTable, fd))
+		if (!fd_table_install (&src, fd, fd_table_get (&parent->fdTable, fd)))
+			goto done;
+
+	for (size_t i = 0; i < action_cnt; i++) {
+		const struct spawn_action *a = &actions[i];
+		struct file *file = fd_table_get (&src, a->fd);
+		if (a->fd < 0 || a->fd >= FDCOUNT_LIMIT)
+			goto done;
+		if (a->op == SPAWN_CLOSE)
+			fd_table_clear (&src, a->fd);
+		else if (a->op != SPAWN_DUP2 || file == NULL
+				|| !fd_table_install (&src, a->newfd, file))
+			goto done;
+	}
+
+	fd_table_clear (&child->fdTable, 0);
+	fd_table_clear (&child->fdTable, 1);
+	child->stdin_count = child->stdout_count = 0;
+	for (int i = fd_table_next (&src, -1); i >= 0; i = fd_table_next (&src, i)) {
+		struct file *file = fd_table_get (&src, i);
+		if ((uintptr_t) file <= 2) {
+			if (!fd_table_install (&child->fdTable, i, file))
+				goto done;
+			if ((uintptr_t) file == 1)
+				child->stdin_count++;
+			else
+				child->stdout_count++;
+			continue;
+		}
+
+		if (!fd_table_install (&child->fdTable, i, file_dup (file))) {
+			file_close (file);
+			goto done;
+		}
+	}
+	success = true;
+
+done:
+	fd_table_destroy (&src);
+	return success;
+}
+
+/* A thread function that builds a spawned child, see process_spawn(). */
+static void
+spawn_child (void *aux) {
+	struct spawn_args *args = aux;
+	struct thread *parent = args->parent;
+	struct thread *current = thread_current ();
+	struct intr_frame if_;
+
+	current->exit_rec = args->rec;
+
+	memset (&if_, 0, sizeof if_);
+	if_.ds = if_.es = if_.ss = SEL_UDSEG;
+	if_.cs = SEL_UCSEG;
+	if_.eflags = FLAG_IF | FLAG_MBS;
+
+#ifdef VM
+	current->stack_limit = parent->stack_limit;
+	current->rss_limit = parent->rss_limit;
+	current->rss_min = parent->rss_min;
+	supplemental_page_table_init (&current->spt);
+#endif
+	if (!spawn_inherit_files (current, parent, args->actions,
+				args->action_cnt))
+		goto error;
+	if (!load_argv (args->path, args->argv, args->argc, &if_))
+		goto error;
+
+	child_started (current->exit_rec, true);
+	do_iret (&if_);
+	NOT_REACHED ();
+
+error:
+	child_started (current->exit_rec, false);
+	exit (TID_ERROR);
+}
+
 /* Switch the current execution context to the f_name.
  * Returns -1 on fail. */
 int
@@ -297,20 +467,23 @@ process_exec (void *f_name) {
  * does nothing. */
 int
 process_wait (tid_t child_tid UNUSED) {
-	struct thread *curr = thread_current ();
-	struct thread *child_th = get_child_with_pid(child_tid);
+	int status;
 
-	if (child_th == NULL)
+	if (child_tid < 0)
 		return -1;
+	if (process_waitpid (child_tid, &status, 0) != child_tid)
+		return -1;
+	return status;						// return 값을 레지스터에 넣어준다 (wait syscall)
+}
 
-	sema_down(&child_th->wait_sema);
-
-	int exit_status = child_th->exit_status; // why??
-
-	list_remove(&child_th->child_elem);
-
-	sema_up(&child_th->free_sema);   		 // Why??
-	return exit_status;						// return 값을 레지스터에 넣어준다 (wait syscall)
+/* Waits for child TID to exit, or for any child if TID is -1, and
+ * stores its exit status in *STATUS. The child has already given back
+ * everything but its exit record by then. Returns the child's tid, or
+ * -1 if there is no such child. With WNOHANG in OPTIONS, returns 0
+ * instead of waiting if no such child has exited yet. */
+tid_t
+process_waitpid (tid_t tid, int *status, int options) {
+	return child_wait (&thread_current ()->children, tid, status, options);
 }
 
 
@@ -325,22 +498,30 @@ process_exit (void) {
 	 * TODO: project2/process_termination.html).
 	 * TODO: We recommend you to implement process resource cleanup here. */
 
-	for (int i = 0; i < FDCOUNT_LIMIT; i++)
+	for (int i = fd_table_next (&cur->fdTable, -1); i >= 0;
+			i = fd_table_next (&cur->fdTable, i))
 	{
 		close(i);
 	}
 	/* fdtable 할당해준거 free 해줌*/
-	palloc_free_multiple(cur->fdTable, FDT_PAGES);
+	fd_table_destroy (&cur->fdTable);
 
 	/* file deny 부분 cur->running에는 실행중이 file의 주소가 저장되있음       */
 	/* 때문에 더이상 다른 process(kernel)가 접근 할수있도록 allow해줘야됨*/
 	file_close(cur->running);
 
+	syscall_exit_trace ();
+#ifdef VM
+	if (cur->pml4 != NULL)
+		vm_exit_rusage ();
+#endif
 	process_cleanup ();
 
-	sema_up(&cur->wait_sema);
-	sema_down(&cur->free_sema);
-	
+	/* Nothing but the exit records is left; the thread goes as soon as
+	 * we return, without waiting for the parent. */
+	child_table_destroy (&cur->children);
+	if (cur->exit_rec != NULL)
+		child_exit (cur->exit_rec, cur->exit_status);
 }
 
 /* Free the current process's resources. */
@@ -348,6 +529,7 @@ static void
 process_cleanup (void) {
 	struct thread *curr = thread_current ();
 
+	ioring_destroy ();
 #ifdef VM
 	supplemental_page_table_kill (&curr->spt);
 #endif
@@ -439,6 +621,9 @@ static bool validate_segment (const struct Phdr *, struct file *);
 static bool load_segment (struct file *file, off_t ofs, uint8_t *upage,
 		uint32_t read_bytes, uint32_t zero_bytes,
 		bool writable);
+#ifdef VM
+static void exec_readahead (struct file *file);
+#endif
 
 
 /* Loads an ELF executable from FILE_NAME into the current thread.
@@ -447,13 +632,6 @@ static bool load_segment (struct file *file, off_t ofs, uint8_t *upage,
  * Returns true if successful, false otherwise. */
 static bool
 load (const char *file_name, struct intr_frame *if_) {
-	struct thread *t = thread_current ();
-	struct ELF ehdr;
-	struct file *file = NULL;
-	off_t file_ofs;
-	bool success = false;
-	int i;
-
 	char *token, *save_ptr;
 	char *argv[64];
 	int argc = 0;
@@ -465,6 +643,19 @@ load (const char *file_name, struct intr_frame *if_) {
 		argv[argc] = token;
 		argc++;
 	}
+	return load_argv (argv[0], argv, argc, if_);
+}
+
+/* Loads the ELF executable PATH into the current thread and passes it
+ * the ARGC arguments in ARGV, like load(). */
+static bool
+load_argv (const char *path, char **argv, int argc, struct intr_frame *if_) {
+	struct thread *t = thread_current ();
+	struct ELF ehdr;
+	struct file *file = NULL;
+	off_t file_ofs;
+	bool success = false;
+	int i;
 
 	/* Allocate and activate page directory. */
 	t->pml4 = pml4_create ();
@@ -473,9 +664,9 @@ load (const char *file_name, struct intr_frame *if_) {
 	process_activate (thread_current ());
 
 	/* Open executable file. */
-	file = filesys_open (argv[0]);
+	file = filesys_open (path);
 	if (file == NULL) {
-		printf ("load: %s: open failed\n", argv[0]);
+		printf ("load: %s: open failed\n", path);
 		goto done;
 	}
 	t->running = file;
@@ -488,7 +679,7 @@ load (const char *file_name, struct intr_frame *if_) {
 			|| ehdr.e_version != 1
 			|| ehdr.e_phentsize != sizeof (struct Phdr)
 			|| ehdr.e_phnum > 1024) {
-		printf ("load: %s: error loading executable\n", argv[0]);
+		printf ("load: %s: error loading executable\n", path);
 		goto done;
 	}
 
@@ -545,6 +736,12 @@ load (const char *file_name, struct intr_frame *if_) {
 		}
 	}
 
+#ifdef VM
+	/* The headers are good: start reading the image in while the stack
+	 * and arguments are set up. */
+	exec_readahead (file);
+#endif
+
 	/* Set up stack. */
 	if (!setup_stack (if_))
 		goto done;
@@ -731,17 +928,24 @@ lazy_load_segment (struct page *page, void *aux) {
 	/* TODO: This called when the first page fault occurs on address VA. */
 	/* TODO: VA is available when calling this function. */
 
-  struct file *file = ((struct load_info *)aux)->file;
-	off_t ofs = ((struct load_info*)aux)->ofs;
-  size_t page_read_bytes = ((struct load_info *)aux)->page_read_bytes;
+	/* AUX is the segment's area. Pages with no file data at all are
+	 * demand-zero and never get here. */
+	struct vma *vma = aux;
+  struct file *file = vma->file;
+	off_t ofs = vma_page_offset (vma, page->va);
+  size_t page_read_bytes = vma_page_read_bytes (vma, page->va);
   size_t page_zero_bytes = PGSIZE - page_read_bytes;
 
-	file_seek (file, ofs);
+	/* Read-ahead may have cached the page already. */
+	if (fcache_copy (file_get_inode (file), ofs, page_read_bytes,
+				page->frame->kva))
+		return true;
 
-  if (file_read (file, page->frame->kva, page_read_bytes) != (int) page_read_bytes) {
-        palloc_free_page (page->frame->kva);
-        return false;
-  }
+	/* On failure the caller frees the frame. */
+	if (file_read_at (file, page->frame->kva, page_read_bytes, ofs)
+			!= (int) page_read_bytes)
+		return false;
+	thread_current ()->rusage.inblock++;
 
 	memset(page->frame->kva + page_read_bytes, 0, page_zero_bytes);
 
@@ -769,33 +973,36 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
 	ASSERT (pg_ofs (upage) == 0);
 	ASSERT (ofs % PGSIZE == 0);
 
-	while (read_bytes > 0 || zero_bytes > 0) {
-		/* Do calculate how to fill this page.
-		 * We will read PAGE_READ_BYTES bytes from FILE
-		 * and zero the final PAGE_ZERO_BYTES bytes. */
-		size_t page_read_bytes = read_bytes < PGSIZE ? read_bytes : PGSIZE;
-		size_t page_zero_bytes = PGSIZE - page_read_bytes;
-
-		/* TODO: Set up aux to pass information to the lazy_load_segment. */
-    struct load_info *box = (struct load_info*)malloc(sizeof(struct load_info));
-
-		box->file = file;
-		box->ofs = ofs;
-		box->page_read_bytes = page_read_bytes;
-
+	/* One area covers the whole segment. Its pages are created on first
+	 * access: those holding file data are loaded by lazy_load_segment(),
+	 * the rest are demand-zero. */
+	return vma_create (&thread_current ()->spt.vmas, upage,
+			read_bytes + zero_bytes, file, ofs, read_bytes, writable,
+			VMA_SEGMENT) != NULL;
+}
 
-		if (!vm_alloc_page_with_initializer (VM_ANON, upage,
-					writable, lazy_load_segment, box))
-			return false;
+/* Pages of a new executable image read ahead at exec time. */
+#define EXEC_READAHEAD_MAX 32
 
-		/* Advance. */
-		read_bytes -= page_read_bytes;
-		zero_bytes -= page_zero_bytes;
-		upage += PGSIZE;
-
-		ofs += page_read_bytes;
+/* Queues the first pages with file data of each segment of the current
+ * process, up to EXEC_READAHEAD_MAX in total, for the readahead thread,
+ * so the first faults of the program find them in the frame cache. */
+static void
+exec_readahead (struct file *file) {
+	struct vma_table *vmas = &thread_current ()->spt.vmas;
+	struct inode *inode = file_get_inode (file);
+	size_t budget = EXEC_READAHEAD_MAX;
+
+	for (size_t i = 0; i < vmas->cnt && budget > 0; i++) {
+		struct vma *vma = vmas->areas[i];
+		for (void *va = vma->start; va < vma->end && budget > 0; va += PGSIZE) {
+			size_t read_bytes = vma_page_read_bytes (vma, va);
+			if (read_bytes == 0)
+				break;
+			fcache_prefetch (inode, vma_page_offset (vma, va), read_bytes);
+			budget--;
+		}
 	}
-	return true;
 }
 
 /* Create a PAGE of stack at the USER_STACK. Return true on success. */
@@ -809,7 +1016,8 @@ setup_stack (struct intr_frame *if_) {
 	 * TODO: You should mark the page is stack. */
 	/* TODO: Your code goes here */
 
-	if (vm_alloc_page(VM_ANON | VM_MARKER_0, stack_bottom, 1))
+	if (vm_alloc_page_with_initializer (VM_ANON | VM_MARKER_0, stack_bottom,
+				1, vm_zero_page, NULL))
 	{
 		
 		success = vm_claim_page(stack_bottom);
@@ -869,18 +1077,3 @@ void argument_stack(char **argv, int argc, struct intr_frame *if_)
 	//hex_dump(if_->rsp, rsp, USER_STACK-if_->rsp, true);
 
 }
-
-
-struct thread *get_child_with_pid(int pid)
-{
-	struct thread *cur = thread_current();
-	struct list *child_list = &cur->child_list;
-
-	for (struct list_elem *e = list_begin(child_list); e != list_end(child_list); e = list_next(e))
-	{
-		struct thread *t = list_entry(e, struct thread, child_elem);
-		if (t->tid == pid)
-			return t;
-	}
-	return NULL;
-}
\ No newline at end of file
@@ -7,19 +7,27 @@
 #include "userprog/gdt.h"
 #include "userprog/process.h"
 #include "userprog/syscall.h"
+#include "devices/disk.h"
 #include "filesys/filesys.h"
 #include "filesys/file.h"
+#include <limits.h>
 #include <list.h>
 #include <stdio.h>
 #include <syscall-nr.h>
+#include <string.h>
 #include "intrinsic.h"
+#include "threads/malloc.h"
+#include "userprog/child.h"
+#include "userprog/ioring.h"
+#include "userprog/pipe.h"
+#include "userprog/usercopy.h"
 #include "vm/vm.h"
 
 void syscall_entry(void);
 void syscall_handler(struct intr_frame *);
 
 /* Projects 2 and later. */
-void check_address(const uint64_t *);
+static char *copy_in_string (const char *ustr);
 void halt (void) NO_RETURN;
 void exit (int status) NO_RETURN;
 tid_t fork(const char *, struct intr_frame *);
@@ -38,14 +46,30 @@ void close (int fd);
 int dup2(int oldfd, int newfd);
 
 static void* mmap (void *addr, size_t length, int writable, int fd, off_t offset);
-static void munmap (void* addr);
+static int munmap (void* addr);
+static int msync (void *addr, size_t length, int flags);
+static int madvise (void *addr, size_t length, int advice);
+static bool setrlimit (int resource, size_t limit);
+static size_t getrlimit (int resource);
+static int getrusage (struct rusage *usage);
+static int pread (int fd, void *buffer, unsigned size, off_t offset);
+static int pwrite (int fd, const void *buffer, unsigned size, off_t offset);
+static int readv (int fd, const struct iovec *uiov, int iovcnt, void *rsp);
+static int writev (int fd, const struct iovec *uiov, int iovcnt, void *rsp);
+static int copy_file_range (int in_fd, off_t in_off, int out_fd,
+		off_t out_off, unsigned length);
+static tid_t spawn (const char *path, char *const argv[],
+		const struct spawn_action *fd_actions);
+static int pipe (int *fds);
+static tid_t waitpid (tid_t pid, int *status, int options);
 
-int process_add_file (struct file *);
-struct file *process_get_file (int);
 void process_close_file (int);
 
 void check_valid_buffer(void* buffer, unsigned size, void* rsp, bool to_write);
-struct page * check_address2(void *addr);
+static void unpin_buffer (void *buffer, unsigned size);
+static bool pin_buffer (void *buffer, unsigned size, void *rsp,
+		bool to_write);
+struct page * check_address2(void *addr, void *rsp);
 
 const int STDIN = 1;
 const int STDOUT = 2;
@@ -76,6 +100,187 @@ syscall_init (void) {
 	write_msr(MSR_SYSCALL_MASK,
 			FLAG_IF | FLAG_TF | FLAG_DF | FLAG_IOPL | FLAG_AC | FLAG_NT);
 	lock_init(&filesys_lock);
+	ioring_init ();
+}
+
+/* Handler of one system call. ARGS holds the arguments, converted as
+ * the call's descriptor says. */
+typedef uint64_t syscall_func (const uint64_t *args, struct intr_frame *f);
+
+/* Descriptor of a system call. ARGS has one letter per argument, taken
+ * from RDI, RSI, RDX, R10, R8 and R9 in that order:
+ *
+ *   d  int, sign-extended from the low 32 bits
+ *   u  unsigned, the low 32 bits
+ *   z  size_t
+ *   p  pointer into user memory
+ *
+ * RET is the type of the result in the same notation, or 'v' if the call
+ * returns nothing and leaves RAX alone. */
+struct syscall {
+	const char *name;
+	syscall_func *func;
+	const char *args;
+	char ret;
+};
+
+static uint64_t sys_halt (const uint64_t *, struct intr_frame *);
+static uint64_t sys_exit (const uint64_t *, struct intr_frame *);
+static uint64_t sys_fork (const uint64_t *, struct intr_frame *);
+static uint64_t sys_exec (const uint64_t *, struct intr_frame *);
+static uint64_t sys_wait (const uint64_t *, struct intr_frame *);
+static uint64_t sys_create (const uint64_t *, struct intr_frame *);
+static uint64_t sys_remove (const uint64_t *, struct intr_frame *);
+static uint64_t sys_open (const uint64_t *, struct intr_frame *);
+static uint64_t sys_filesize (const uint64_t *, struct intr_frame *);
+static uint64_t sys_read (const uint64_t *, struct intr_frame *);
+static uint64_t sys_write (const uint64_t *, struct intr_frame *);
+static uint64_t sys_seek (const uint64_t *, struct intr_frame *);
+static uint64_t sys_tell (const uint64_t *, struct intr_frame *);
+static uint64_t sys_close (const uint64_t *, struct intr_frame *);
+static uint64_t sys_dup2 (const uint64_t *, struct intr_frame *);
+static uint64_t sys_mmap (const uint64_t *, struct intr_frame *);
+static uint64_t sys_munmap (const uint64_t *, struct intr_frame *);
+static uint64_t sys_msync (const uint64_t *, struct intr_frame *);
+static uint64_t sys_madvise (const uint64_t *, struct intr_frame *);
+static uint64_t sys_setrlimit (const uint64_t *, struct intr_frame *);
+static uint64_t sys_getrlimit (const uint64_t *, struct intr_frame *);
+static uint64_t sys_getrusage (const uint64_t *, struct intr_frame *);
+static uint64_t sys_pread (const uint64_t *, struct intr_frame *);
+static uint64_t sys_pwrite (const uint64_t *, struct intr_frame *);
+static uint64_t sys_readv (const uint64_t *, struct intr_frame *);
+static uint64_t sys_writev (const uint64_t *, struct intr_frame *);
+static uint64_t sys_copy_file_range (const uint64_t *, struct intr_frame *);
+static uint64_t sys_ioring_setup (const uint64_t *, struct intr_frame *);
+static uint64_t sys_ioring_enter (const uint64_t *, struct intr_frame *);
+static uint64_t sys_spawn (const uint64_t *, struct intr_frame *);
+static uint64_t sys_pipe (const uint64_t *, struct intr_frame *);
+static uint64_t sys_waitpid (const uint64_t *, struct intr_frame *);
+
+/* System calls by number. Numbers without an entry are invalid. */
+static const struct syscall syscall_table[] = {
+	[SYS_HALT] = { "halt", sys_halt, "", 'v' },
+	[SYS_EXIT] = { "exit", sys_exit, "d", 'v' },
+	[SYS_FORK] = { "fork", sys_fork, "p", 'd' },
+	[SYS_EXEC] = { "exec", sys_exec, "p", 'd' },
+	[SYS_WAIT] = { "wait", sys_wait, "d", 'd' },
+	[SYS_CREATE] = { "create", sys_create, "pu", 'd' },
+	[SYS_REMOVE] = { "remove", sys_remove, "p", 'd' },
+	[SYS_OPEN] = { "open", sys_open, "p", 'd' },
+	[SYS_FILESIZE] = { "filesize", sys_filesize, "d", 'd' },
+	[SYS_READ] = { "read", sys_read, "dpu", 'd' },
+	[SYS_WRITE] = { "write", sys_write, "dpu", 'd' },
+	[SYS_SEEK] = { "seek", sys_seek, "du", 'v' },
+	[SYS_TELL] = { "tell", sys_tell, "d", 'u' },
+	[SYS_CLOSE] = { "close", sys_close, "d", 'v' },
+	[SYS_DUP2] = { "dup2", sys_dup2, "dd", 'd' },
+	[SYS_MMAP] = { "mmap", sys_mmap, "pzddd", 'p' },
+	[SYS_MUNMAP] = { "munmap", sys_munmap, "p", 'd' },
+	[SYS_MSYNC] = { "msync", sys_msync, "pzd", 'd' },
+	[SYS_MADVISE] = { "madvise", sys_madvise, "pzd", 'd' },
+	[SYS_SETRLIMIT] = { "setrlimit", sys_setrlimit, "dz", 'd' },
+	[SYS_GETRLIMIT] = { "getrlimit", sys_getrlimit, "d", 'z' },
+	[SYS_GETRUSAGE] = { "getrusage", sys_getrusage, "p", 'd' },
+	[SYS_PREAD] = { "pread", sys_pread, "dpud", 'd' },
+	[SYS_PWRITE] = { "pwrite", sys_pwrite, "dpud", 'd' },
+	[SYS_READV] = { "readv", sys_readv, "dpd", 'd' },
+	[SYS_WRITEV] = { "writev", sys_writev, "dpd", 'd' },
+	[SYS_COPY_FILE_RANGE] = { "copy_file_range", sys_copy_file_range,
+		"ddddu", 'd' },
+	[SYS_IORING_SETUP] = { "ioring_setup", sys_ioring_setup, "pu", 'p' },
+	[SYS_IORING_ENTER] = { "ioring_enter", sys_ioring_enter, "uu", 'd' },
+	[SYS_SPAWN] = { "spawn", sys_spawn, "ppp", 'd' },
+	[SYS_PIPE] = { "pipe", sys_pipe, "p", 'd' },
+	[SYS_WAITPID] = { "waitpid", sys_waitpid, "dpd", 'd' },
+};
+
+#define SYSCALL_CNT (sizeof syscall_table / sizeof *syscall_table)
+
+/* Cycle histogram buckets. Bucket I counts calls that took from
+ * 2^(I + HIST_SHIFT) up to 2^(I + HIST_SHIFT + 1) cycles; the first and
+ * last buckets are open-ended. */
+#define HIST_SHIFT 8
+#define HIST_BUCKETS 16
+
+/* Statistics of one system call. */
+struct syscall_stat {
+	long long calls;
+	long long cycles;
+	long long hist[HIST_BUCKETS];
+};
+
+static struct syscall_stat syscall_stats[SYSCALL_CNT];
+
+/* Log "-strace": the last TRACE_SIZE calls of each process, printed
+ * when it exits. */
+bool syscall_trace;
+
+#define TRACE_SIZE 32
+
+/* One traced call. */
+struct trace_record {
+	int nr;                     /* SYS_* */
+	uint64_t args[6];
+	uint64_t ret;
+	uint64_t cycles;
+	bool done;                  /* False if the call did not return. */
+};
+
+/* Ring buffer of a process's most recent calls. */
+struct syscall_trace {
+	struct trace_record ring[TRACE_SIZE];
+	long long total;            /* Calls traced so far. */
+};
+
+/* Converts the registers of F into the arguments of SC. */
+static void
+syscall_marshal (const struct syscall *sc, struct intr_frame *f,
+		uint64_t *args) {
+	const uint64_t regs[6] = { f->R.rdi, f->R.rsi, f->R.rdx, f->R.r10,
+		f->R.r8, f->R.r9 };
+
+	for (int i = 0; sc->args[i] != '\0'; i++)
+		switch (sc->args[i]) {
+			case 'd':
+				args[i] = (uint64_t) (int64_t) (int32_t) regs[i];
+				break;
+			case 'u':
+				args[i] = (uint32_t) regs[i];
+				break;
+			default:
+				args[i] = regs[i];
+				break;
+		}
+}
+
+/* Returns the histogram bucket of a call that took CYCLES cycles. */
+static int
+hist_bucket (uint64_t cycles) {
+	int log = 0;
+
+	while (cycles >>= 1)
+		log++;
+	log -= HIST_SHIFT;
+	return log < 0 ? 0 : log >= HIST_BUCKETS ? HIST_BUCKETS - 1 : log;
+}
+
+/* Starts a trace record of call NR with ARGS for the current process,
+ * allocating its ring on first use. Returns NULL if out of memory. */
+static struct trace_record *
+trace_begin (int nr, const uint64_t *args) {
+	struct thread *curr = thread_current ();
+
+	if (curr->trace == NULL) {
+		curr->trace = calloc (1, sizeof *curr->trace);
+		if (curr->trace == NULL)
+			return NULL;
+	}
+	struct trace_record *rec = &curr->trace->ring[curr->trace->total++
+		% TRACE_SIZE];
+	rec->nr = nr;
+	memcpy (rec->args, args, sizeof rec->args);
+	rec->done = false;
+	return rec;
 }
 
 /* The main system call interface */
@@ -83,99 +288,382 @@ void
 syscall_handler (struct intr_frame *f UNUSED) {
 	// TODO: Your implementation goes here.
 	struct thread* curr = thread_current ();
+	uint64_t nr = f->R.rax;
+	uint64_t args[6] = { 0 };
+
 	curr->saved_sp = f->rsp;
-	switch (f->R.rax)
-	{
-	case SYS_HALT:
-		halt();
-		break;
-	case SYS_EXIT:
-		exit(f->R.rdi);
-		break;
-	case SYS_FORK:
-		f->R.rax = fork(f->R.rdi, f);
-		break;
-	case SYS_EXEC:
-		if (exec(f->R.rdi) == -1)
-			exit(-1);
-		break;
-	case SYS_WAIT:
-		f->R.rax = process_wait(f->R.rdi);
-		break;
-	case SYS_CREATE:
-		f->R.rax = create(f->R.rdi, f->R.rsi);
-		break;
-	case SYS_REMOVE:
-		f->R.rax = remove(f->R.rdi);
-		break;
-	case SYS_OPEN:
-		f->R.rax = open(f->R.rdi);
-		break;
-	case SYS_FILESIZE:
-		f->R.rax = filesize(f->R.rdi);
-		break;
-	case SYS_READ:
-		check_valid_buffer(f->R.rsi, f->R.rdx, f->rsp, 1);
-		f->R.rax = read(f->R.rdi, f->R.rsi, f->R.rdx);
-		break;
-	case SYS_WRITE:
-		check_valid_buffer(f->R.rsi, f->R.rdx, f->rsp, 0);
-		f->R.rax = write(f->R.rdi, f->R.rsi, f->R.rdx);
-		break;
-	case SYS_SEEK:
-		seek(f->R.rdi, f->R.rsi);
-		break;
-	case SYS_TELL:
-		f->R.rax = tell(f->R.rdi);
-		break;
-	case SYS_CLOSE:
-		close(f->R.rdi);
-		break;
-	case SYS_DUP2:
-		f->R.rax = dup2(f->R.rdi, f->R.rsi);
-		break;
-	//project 3-mmf
-	case SYS_MMAP:
-		f->R.rax = (uint64_t) mmap ((void*) f->R.rdi, (size_t) f->R.rsi, (int) f->R.rdx, (int) f->R.r10, (off_t) f->R.r8);
-		break;
-	case SYS_MUNMAP:
-		munmap ((void*) f->R.rdi);
-		break;
-	// default:
-	// 	exit(-1);
-	// 	break;
-	NOT_REACHED();
+	if (nr >= SYSCALL_CNT || syscall_table[nr].func == NULL)
+		exit (-1);
+
+	const struct syscall *sc = &syscall_table[nr];
+	syscall_marshal (sc, f, args);
+	struct trace_record *rec = syscall_trace ? trace_begin (nr, args) : NULL;
+
+	uint64_t start = rdtsc ();
+	uint64_t ret = sc->func (args, f);
+	uint64_t cycles = rdtsc () - start;
+	if (sc->ret != 'v')
+		f->R.rax = ret;
+
+	enum intr_level old_level = intr_disable ();
+	struct syscall_stat *stat = &syscall_stats[nr];
+	stat->calls++;
+	stat->cycles += cycles;
+	stat->hist[hist_bucket (cycles)]++;
+	intr_set_level (old_level);
+
+	if (rec != NULL) {
+		rec->ret = ret;
+		rec->cycles = cycles;
+		rec->done = true;
 	}
 }
 
-void check_address(const uint64_t *uaddr)
+/* Prints VALUE, a syscall argument or result of type TYPE. */
+static void
+print_value (char type, uint64_t value) {
+	switch (type) {
+		case 'd':
+			printf ("%lld", (long long) value);
+			break;
+		case 'p':
+			printf ("%p", (void *) value);
+			break;
+		default:
+			printf ("%llu", (unsigned long long) value);
+			break;
+	}
+}
+
+/* Prints the calls traced for the current process, oldest first, and
+ * frees its trace. Called as the process exits. */
+void
+syscall_exit_trace (void) {
+	struct syscall_trace *trace = thread_current ()->trace;
+
+	if (trace == NULL)
+		return;
+	long long first = trace->total > TRACE_SIZE ? trace->total - TRACE_SIZE : 0;
+	printf ("%s: strace: %lld calls, last %lld:\n", thread_name (),
+			trace->total, trace->total - first);
+	for (long long i = first; i < trace->total; i++) {
+		const struct trace_record *rec = &trace->ring[i % TRACE_SIZE];
+		const struct syscall *sc = &syscall_table[rec->nr];
+
+		printf ("  %s(", sc->name);
+		for (int k = 0; sc->args[k] != '\0'; k++) {
+			if (k > 0)
+				printf (", ");
+			print_value (sc->args[k], rec->args[k]);
+		}
+		printf (")");
+		if (!rec->done)
+			printf (" = ?\n");
+		else {
+			if (sc->ret != 'v') {
+				printf (" = ");
+				print_value (sc->ret, rec->ret);
+			}
+			printf (" <%llu cycles>\n", (unsigned long long) rec->cycles);
+		}
+	}
+	free (trace);
+	thread_current ()->trace = NULL;
+}
+
+/* Prints the call count, mean cycles and cycle histogram of every system
+ * call that was made. */
+void
+syscall_print_stats (void) {
+	for (size_t nr = 0; nr < SYSCALL_CNT; nr++) {
+		const struct syscall_stat *stat = &syscall_stats[nr];
+
+		if (stat->calls == 0)
+			continue;
+		printf ("Syscall %s: %lld calls, %lld cycles mean, histogram",
+				syscall_table[nr].name, stat->calls, stat->cycles / stat->calls);
+		for (int i = 0; i < HIST_BUCKETS; i++)
+			if (stat->hist[i] != 0)
+				printf (" 2^%d:%lld", i + HIST_SHIFT, stat->hist[i]);
+		printf ("\n");
+	}
+}
+
+static uint64_t
+sys_halt (const uint64_t *args UNUSED, struct intr_frame *f UNUSED) {
+	halt ();
+}
+
+static uint64_t
+sys_exit (const uint64_t *args, struct intr_frame *f UNUSED) {
+	exit (args[0]);
+}
+
+static uint64_t
+sys_fork (const uint64_t *args, struct intr_frame *f) {
+	return fork ((const char *) args[0], f);
+}
+
+static uint64_t
+sys_exec (const uint64_t *args, struct intr_frame *f UNUSED) {
+	/* Returns only on failure. */
+	exec ((const char *) args[0]);
+	exit (-1);
+}
+
+static uint64_t
+sys_wait (const uint64_t *args, struct intr_frame *f UNUSED) {
+	return process_wait (args[0]);
+}
+
+static uint64_t
+sys_create (const uint64_t *args, struct intr_frame *f UNUSED) {
+	return create ((const char *) args[0], args[1]);
+}
+
+static uint64_t
+sys_remove (const uint64_t *args, struct intr_frame *f UNUSED) {
+	return remove ((const char *) args[0]);
+}
+
+static uint64_t
+sys_open (const uint64_t *args, struct intr_frame *f UNUSED) {
+	return open ((const char *) args[0]);
+}
+
+static uint64_t
+sys_filesize (const uint64_t *args, struct intr_frame *f UNUSED) {
+	return filesize (args[0]);
+}
+
+static uint64_t
+sys_read (const uint64_t *args, struct intr_frame *f) {
+	void *buffer = (void *) args[1];
+	unsigned size = args[2];
+
+	check_valid_buffer (buffer, size, (void *) f->rsp, true);
+	int ret = read (args[0], buffer, size);
+	unpin_buffer (buffer, size);
+	return ret;
+}
+
+static uint64_t
+sys_write (const uint64_t *args, struct intr_frame *f) {
+	void *buffer = (void *) args[1];
+	unsigned size = args[2];
+
+	check_valid_buffer (buffer, size, (void *) f->rsp, false);
+	int ret = write (args[0], buffer, size);
+	unpin_buffer (buffer, size);
+	return ret;
+}
+
+static uint64_t
+sys_seek (const uint64_t *args, struct intr_frame *f UNUSED) {
+	seek (args[0], args[1]);
+	return 0;
+}
+
+static uint64_t
+sys_tell (const uint64_t *args, struct intr_frame *f UNUSED) {
+	return tell (args[0]);
+}
+
+static uint64_t
+sys_close (const uint64_t *args, struct intr_frame *f UNUSED) {
+	close (args[0]);
+	return 0;
+}
+
+static uint64_t
+sys_dup2 (const uint64_t *args, struct intr_frame *f UNUSED) {
+	return dup2 (args[0], args[1]);
+}
+
+//project 3-mmf
+static uint64_t
+sys_mmap (const uint64_t *args, struct intr_frame *f UNUSED) {
+	return (uint64_t) mmap ((void *) args[0], args[1], args[2], args[3],
+			args[4]);
+}
+
+static uint64_t
+sys_munmap (const uint64_t *args, struct intr_frame *f UNUSED) {
+	return munmap ((void *) args[0]);
+}
+
+static uint64_t
+sys_msync (const uint64_t *args, struct intr_frame *f UNUSED) {
+	return msync ((void *) args[0], args[1], args[2]);
+}
+
+static uint64_t
+sys_madvise (const uint64_t *args, struct intr_frame *f UNUSED) {
+	return madvise ((void *) args[0], args[1], args[2]);
+}
+
+static uint64_t
+sys_setrlimit (const uint64_t *args, struct intr_frame *f UNUSED) {
+	return setrlimit (args[0], args[1]);
+}
+
+static uint64_t
+sys_getrlimit (const uint64_t *args, struct intr_frame *f UNUSED) {
+	return getrlimit (args[0]);
+}
+
+static uint64_t
+sys_getrusage (const uint64_t *args, struct intr_frame *f UNUSED) {
+	return getrusage ((struct rusage *) args[0]);
+}
+
+static uint64_t
+sys_pread (const uint64_t *args, struct intr_frame *f) {
+	void *buffer = (void *) args[1];
+	unsigned size = args[2];
+
+	check_valid_buffer (buffer, size, (void *) f->rsp, true);
+	int ret = pread (args[0], buffer, size, args[3]);
+	unpin_buffer (buffer, size);
+	return ret;
+}
+
+static uint64_t
+sys_pwrite (const uint64_t *args, struct intr_frame *f) {
+	void *buffer = (void *) args[1];
+	unsigned size = args[2];
+
+	check_valid_buffer (buffer, size, (void *) f->rsp, false);
+	int ret = pwrite (args[0], buffer, size, args[3]);
+	unpin_buffer (buffer, size);
+	return ret;
+}
+
+static uint64_t
+sys_readv (const uint64_t *args, struct intr_frame *f) {
+	return readv (args[0], (const struct iovec *) args[1], args[2],
+			(void *) f->rsp);
+}
+
+static uint64_t
+sys_writev (const uint64_t *args, struct intr_frame *f) {
+	return writev (args[0], (const struct iovec *) args[1], args[2],
+			(void *) f->rsp);
+}
+
+static uint64_t
+sys_copy_file_range (const uint64_t *args, struct intr_frame *f UNUSED) {
+	return copy_file_range (args[0], args[1], args[2], args[3], args[4]);
+}
+
+static uint64_t
+sys_ioring_setup (const uint64_t *args, struct intr_frame *f UNUSED) {
+	return (uint64_t) ioring_setup ((void *) args[0], args[1]);
+}
+
+static uint64_t
+sys_ioring_enter (const uint64_t *args, struct intr_frame *f UNUSED) {
+	return ioring_enter (args[0], args[1]);
+}
+
+static uint64_t
+sys_spawn (const uint64_t *args, struct intr_frame *f UNUSED) {
+	return spawn ((const char *) args[0], (char *const *) args[1],
+			(const struct spawn_action *) args[2]);
+}
+
+static uint64_t
+sys_pipe (const uint64_t *args, struct intr_frame *f UNUSED) {
+	return pipe ((int *) args[0]);
+}
+
+static uint64_t
+sys_waitpid (const uint64_t *args, struct intr_frame *f UNUSED) {
+	return waitpid (args[0], (int *) args[1], args[2]);
+}
+
+/* Copies the user string USTR into a new page, which the caller frees.
+ * Exits if USTR is a bad pointer. Returns NULL if the string does not
+ * fit in a page or memory is short. */
+static char *
+copy_in_string (const char *ustr)
 {
-	struct thread *curr = thread_current ();
-	if (uaddr == NULL || !(is_user_vaddr(uaddr)) || pml4_get_page(curr->pml4, uaddr) == NULL || pml4e_walk(curr->pml4, uaddr,0) == NULL)
-		exit(-1);
+	char *kstr = palloc_get_page (0);
+	if (kstr == NULL)
+		return NULL;
+
+	int len = strncpy_from_user (kstr, ustr, PGSIZE);
+	if (len < 0) {
+		palloc_free_page (kstr);
+		exit (-1);
+	}
+	if (len == PGSIZE) {
+		palloc_free_page (kstr);
+		return NULL;
+	}
+	return kstr;
 }
 
-struct page * check_address2(void *addr){
+struct page * check_address2(void *addr, void *rsp){
     if (is_kernel_vaddr(addr))
     {
         exit(-1);
     }
-    return spt_find_page(&thread_current()->spt, addr);
+    return vm_get_page(addr, (uintptr_t) rsp);
 }
 
-void check_valid_buffer(void* buffer, unsigned size, void* rsp, bool to_write)
+/* Checks [BUFFER, BUFFER + SIZE) one page at a time and pins each page,
+ * so that the transfer neither faults nor races with eviction while
+ * filesys_lock is held. Returns false, with no page left pinned, if a
+ * page is invalid. Undo with unpin_buffer(). */
+static bool
+pin_buffer (void *buffer, unsigned size, void *rsp, bool to_write)
 {
     /* 인자로받은buffer부터buffer + size까지의크기가한페이지의크기를넘을수도있음*/
     /*check_address를이용해서주소의유저영역여부를검사함과동시에vm_entry구조체를얻음*/
     /* 해당주소에대한vm_entry존재여부와vm_entry의writable멤버가true인지검사*/
     /* 위내용을buffer부터buffer + size까지의주소에포함되는vm_entry들에대해적용*/
-    for (int i = 0; i < size; i++)
+    if (size == 0)
+        return true;
+    if (buffer + size < buffer || is_kernel_vaddr(buffer + size - 1))
+        return false;
+    for (void *addr = buffer; addr < buffer + size;
+            addr = pg_round_down(addr) + PGSIZE)
     {
-        struct page* page = check_address2(buffer + i);
-        if(page == NULL)
-            exit(-1);
-        if(to_write == true && page->writable == false)
-            exit(-1);
+        struct page* page = check_address2(addr, rsp);
+        if (page == NULL || (to_write && !page->writable)
+                || !vm_pin_page(page))
+        {
+            /* Pins on shared frames would outlive the process. */
+            unpin_buffer(buffer, addr - buffer);
+            return false;
+        }
+    }
+    return true;
+}
+
+/* Pins [BUFFER, BUFFER + SIZE) like pin_buffer(), and terminates the
+ * process if the buffer is invalid. */
+void check_valid_buffer(void* buffer, unsigned size, void* rsp, bool to_write)
+{
+    if (!pin_buffer(buffer, size, rsp, to_write))
+        exit(-1);
+}
+
+/* Unpins the pages of a buffer checked by check_valid_buffer(). */
+static void
+unpin_buffer (void *buffer, unsigned size)
+{
+    struct supplemental_page_table *spt = &thread_current ()->spt;
+
+    /* Pins are counted, so only pages check_valid_buffer() pinned. */
+    if (size == 0)
+        return;
+    for (void *va = pg_round_down(buffer); va < buffer + size; va += PGSIZE)
+    {
+        struct page *page = spt_find_page(spt, va);
+        if (page != NULL)
+            vm_unpin_page(page);
     }
 }
 
@@ -197,14 +685,24 @@ void exit(int status)
 
 bool create(const char *file, unsigned initial_size)
 {
-	check_address (file);
-	return filesys_create(file, initial_size);
+	char *name = copy_in_string (file);
+	if (name == NULL)
+		return false;
+
+	bool success = filesys_create(name, initial_size);
+	palloc_free_page (name);
+	return success;
 }
 
 bool remove(const char *file)
 {
-	check_address (file);
-	return filesys_remove (file);
+	char *name = copy_in_string (file);
+	if (name == NULL)
+		return false;
+
+	bool success = filesys_remove (name);
+	palloc_free_page (name);
+	return success;
 }
 
 int wait (tid_t tid)
@@ -214,16 +712,11 @@ int wait (tid_t tid)
 
 int exec(const char *file_name)
 {
-	struct thread *curr = thread_current ();
-	check_address(file_name);
-
 	// process_exec -> process_cleanup 으로 인해 f->R.rdi 날아감.  때문에 복사 후 다시 넣어줌
-	int size = strlen(file_name) + 1;
-	char *fn_copy = palloc_get_page(PAL_ZERO);
+	char *fn_copy = copy_in_string (file_name);
 
 	if (fn_copy == NULL)
 		exit(-1);
-	strlcpy(fn_copy, file_name, size);	
 
 	if (process_exec (fn_copy) == -1)
 		return -1;
@@ -235,8 +728,12 @@ int exec(const char *file_name)
 int open (const char *file)
 {
 	// file이 존재하는지 항상 체크
-	check_address(file);
-	struct file *file_obj = filesys_open(file);
+	char *name = copy_in_string (file);
+	if (name == NULL)
+		return -1;
+
+	struct file *file_obj = filesys_open(name);
+	palloc_free_page (name);
 
 	if (file_obj == NULL)
 		return -1;
@@ -251,7 +748,7 @@ int open (const char *file)
 
 int filesize (int fd)
 {
-	struct file *file_obj = process_get_file(fd);
+	struct file *file_obj = get_seekable_file(fd);
 	if (file_obj == NULL)
 		return -1;
 
@@ -288,6 +785,10 @@ int read (int fd, void *buffer, unsigned size)
 	if (file_obj == 2) {
 		return -1;
 	}
+
+	if (file_obj->pipe != NULL)
+		return file_obj->pipe_writer ? -1
+			: pipe_read (file_obj->pipe, buffer, size);
 	
 	lock_acquire (&filesys_lock);
 	ret = file_read(file_obj, buffer, size);
@@ -321,6 +822,10 @@ int write (int fd, const void *buffer, unsigned size)
 	if (file_obj == 1) {
 		return -1;
 	}
+
+	if (file_obj->pipe != NULL)
+		return file_obj->pipe_writer
+			? pipe_write (file_obj->pipe, buffer, size) : -1;
 	
 	lock_acquire (&filesys_lock);
 	ret = file_write(file_obj, buffer, size);
@@ -331,9 +836,9 @@ int write (int fd, const void *buffer, unsigned size)
 
 void seek (int fd, unsigned position)
 {
-	struct file *file_obj = process_get_file(fd);
+	struct file *file_obj = get_seekable_file(fd);
 	
-	if (file_obj <= 2)
+	if (file_obj == NULL)
 		return ;
 
 	file_obj->pos = position;
@@ -342,9 +847,9 @@ void seek (int fd, unsigned position)
 
 unsigned tell (int fd)
 {
-	struct file *file_obj = process_get_file(fd);
+	struct file *file_obj = get_seekable_file(fd);
 
-	if (file_obj <= 2)
+	if (file_obj == NULL)
 		return ;
 
 	return file_tell(file_obj);
@@ -369,16 +874,18 @@ void close (int fd)
 	if (fd <= 1 || file_obj <= 2)
 		return;
 	process_close_file(fd);
-
-	if (file_obj->dupCount == 0)
-		file_close(file_obj);
-	else
-		file_obj->dupCount --;
+	file_close(file_obj);
 }
 
 tid_t fork (const char *thread_name, struct intr_frame *if_)
 {
-	return process_fork (thread_name, if_);
+	char *name = copy_in_string (thread_name);
+	if (name == NULL)
+		return TID_ERROR;
+
+	tid_t tid = process_fork (name, if_);
+	palloc_free_page (name);
+	return tid;
 }
 
 int dup2 (int oldfd, int newfd)
@@ -387,26 +894,30 @@ int dup2 (int oldfd, int newfd)
 	if (old_file == NULL)
 		return -1;
 	
-	struct file *new_file = process_get_file(newfd);
+	if (newfd < 0 || newfd >= FDCOUNT_LIMIT)
+		return -1;
 			
 	if (oldfd == newfd)
 		return newfd;
 
 	struct thread *curr = thread_current ();
-	struct file **fdt = curr->fdTable;
+
+	/* Both descriptors now share OLD_FILE, position included. */
+	if ((uintptr_t) old_file > 2)
+		file_dup (old_file);
+	close(newfd);
+	if (!fd_table_install (&curr->fdTable, newfd, old_file)) {
+		if ((uintptr_t) old_file > 2)
+			file_close (old_file);
+		return -1;
+	}
 
 	if (old_file == 1)
 		curr->stdin_count ++;
 	
 	else if (old_file == 2)
 		curr->stdout_count ++;
-	
-	else
-		old_file->dupCount ++;
-
 
-	close(newfd);
-	fdt[newfd] = old_file;	
 	return newfd;
 }
 
@@ -414,35 +925,22 @@ int dup2 (int oldfd, int newfd)
 int process_add_file (struct file *f)
 {
 	struct thread *curr = thread_current();
-	struct file **fdt = curr->fdTable; // file descriptor table
 
-	while (curr->fdIdx < FDCOUNT_LIMIT && fdt[curr->fdIdx])
-		curr->fdIdx++;
-
-	if (curr->fdIdx >= FDCOUNT_LIMIT)
-		return -1;
-
-	fdt[curr->fdIdx] = f;
-	return curr->fdIdx;
+	return fd_table_alloc (&curr->fdTable, f);
 }
 
 struct file *process_get_file (int fd)
 {
 	struct thread *curr = thread_current ();
-	if (fd < 0 || fd >= FDCOUNT_LIMIT)
-		return NULL;
 
-	return curr->fdTable[fd];
+	return fd_table_get (&curr->fdTable, fd);
 }
 
 void process_close_file (int fd)
 {
 	struct thread *curr = thread_current ();
 
-	if (fd < 0 || fd >= FDCOUNT_LIMIT)
-		return ;
-	
-	curr->fdTable[fd] = NULL;
+	fd_table_clear (&curr->fdTable, fd);
 }
 
 static void*
@@ -453,17 +951,424 @@ mmap (void *addr, size_t length, int writable, int fd, off_t offset){
 	if (offset % PGSIZE != 0) return NULL;
 	if ((uint64_t)addr + length == 0) return NULL;
 	if (!is_user_vaddr((uint64_t)addr + length)) return NULL;
-	for (uint64_t i = (uint64_t) addr; i < (uint64_t) addr + length; i += PGSIZE){
-		if (spt_find_page (&thread_current() -> spt, (void*) i)!=NULL) return NULL;
+	if (!spt_range_free (&thread_current() -> spt, addr, pg_round_up (addr + length))) return NULL;
+	if (vm_stack_reserved (addr, pg_round_up (addr + length))) return NULL;
+	if (fd == MAP_ANONYMOUS) {
+		if (length == 0 || offset != 0) return NULL;
+		return shmem_mmap (addr, length, writable);
 	}
 	struct file* file = process_get_file (fd);
 	if (file == NULL) return NULL;
 	if (file == 1 || file == 2) return NULL;
+	if (file->pipe != NULL) return NULL;
 	if (length == 0) return NULL;
 	return do_mmap(addr, length, writable, file, offset);
 }
 
-static void
+/* Returns -1 if ADDR could not be unmapped. */
+static int
 munmap (void* addr){
-	do_munmap(addr);
+	return do_munmap(addr) ? 0 : -1;
+}
+
+/* Writes back the mmap'd pages in [ADDR, ADDR + LENGTH). Returns -1 if
+ * the range is not entirely mapped or FLAGS is invalid. */
+static int
+msync (void *addr, size_t length, int flags){
+	if ((uint64_t)addr % PGSIZE != 0) return -1;
+	if (!is_user_vaddr(addr) || !is_user_vaddr((uint64_t)addr + length)) return -1;
+	if ((uint64_t)addr + length < (uint64_t)addr) return -1;
+	if (flags & ~(MS_ASYNC | MS_INVALIDATE | MS_SYNC)) return -1;
+	if ((flags & MS_ASYNC) && (flags & MS_SYNC)) return -1;
+	if (!do_msync (addr, pg_round_up (addr + length), !(flags & MS_ASYNC))) return -1;
+	return 0;
+}
+
+/* Tells the VM how [ADDR, ADDR + LENGTH) will be used. Returns -1 if the
+ * range or ADVICE is invalid. */
+static int
+madvise (void *addr, size_t length, int advice){
+	if ((uint64_t)addr % PGSIZE != 0) return -1;
+	if (!is_user_vaddr(addr) || !is_user_vaddr((uint64_t)addr + length)) return -1;
+	if ((uint64_t)addr + length < (uint64_t)addr) return -1;
+	if (!vm_madvise (addr, pg_round_up (addr + length), advice)) return -1;
+	return 0;
+}
+
+/* Sets the current process's limit on RESOURCE. The limit is inherited
+ * by fork() and kept across exec(). */
+static bool
+setrlimit (int resource, size_t limit){
+	switch (resource) {
+	case RLIMIT_STACK:
+		return vm_set_stack_limit (limit);
+	case RLIMIT_RSS:
+		return vm_set_rss_limit (limit);
+	case RLIMIT_RSS_MIN:
+		return vm_set_rss_min (limit);
+	default:
+		return false;
+	}
+}
+
+/* Returns the current process's limit on RESOURCE, or 0 if there is no
+ * such resource. */
+static size_t
+getrlimit (int resource){
+	switch (resource) {
+	case RLIMIT_STACK:
+		return thread_current ()->stack_limit;
+	case RLIMIT_RSS:
+		return thread_current ()->rss_limit * PGSIZE;
+	case RLIMIT_RSS_MIN:
+		return thread_current ()->rss_min * PGSIZE;
+	default:
+		return 0;
+	}
+}
+
+/* Copies the paging statistics of the current process to USAGE.
+ * Returns 0, or -1 if USAGE is a bad pointer. */
+static int
+getrusage (struct rusage *usage){
+	struct rusage ru;
+
+	vm_get_rusage (&ru);
+	return copy_to_user (usage, &ru, sizeof ru) == 0 ? 0 : -1;
+}
+
+/* Returns the open file FD refers to, or NULL if FD is not open or is
+ * the console or a pipe, which have no file position. */
+struct file *
+get_seekable_file (int fd)
+{
+	struct file *file_obj = process_get_file (fd);
+
+	if ((uintptr_t) file_obj <= (uintptr_t) STDOUT || file_obj->pipe != NULL)
+		return NULL;
+	return file_obj;
+}
+
+/* Reads SIZE bytes at OFFSET of FD into BUFFER, leaving the file
+ * position alone. Returns the number of bytes read, or -1 if FD is not
+ * an open file or OFFSET is negative. */
+static int
+pread (int fd, void *buffer, unsigned size, off_t offset)
+{
+	struct file *file_obj = get_seekable_file (fd);
+	if (file_obj == NULL || offset < 0)
+		return -1;
+
+	lock_acquire (&filesys_lock);
+	int ret = file_read_at (file_obj, buffer, size, offset);
+	lock_release (&filesys_lock);
+	return ret;
+}
+
+/* Writes SIZE bytes from BUFFER at OFFSET of FD, leaving the file
+ * position alone. Returns the number of bytes written, or -1 if FD is
+ * not an open file or OFFSET is negative. */
+static int
+pwrite (int fd, const void *buffer, unsigned size, off_t offset)
+{
+	struct file *file_obj = get_seekable_file (fd);
+	if (file_obj == NULL || offset < 0)
+		return -1;
+
+	lock_acquire (&filesys_lock);
+	int ret = file_write_at (file_obj, buffer, size, offset);
+	lock_release (&filesys_lock);
+	return ret;
+}
+
+/* Unpins the buffers of IOV and frees it. */
+static void
+release_iovec (struct iovec *iov, int iovcnt)
+{
+	for (int i = 0; i < iovcnt; i++)
+		unpin_buffer (iov[i].iov_base, iov[i].iov_len);
+	free (iov);
+}
+
+/* Copies the IOVCNT buffers at UIOV into a new array, which the caller
+ * frees, then checks and pins every buffer. Exits on a bad pointer.
+ * Returns NULL if IOVCNT is out of range, the total length does not fit
+ * in an int, or memory is short. */
+static struct iovec *
+copy_in_iovec (const struct iovec *uiov, int iovcnt, void *rsp,
+		bool to_write)
+{
+	if (iovcnt <= 0 || iovcnt > IOV_MAX)
+		return NULL;
+
+	struct iovec *iov = malloc (iovcnt * sizeof *iov);
+	if (iov == NULL)
+		return NULL;
+	if (copy_from_user (iov, uiov, iovcnt * sizeof *iov) != 0) {
+		free (iov);
+		exit (-1);
+	}
+
+	size_t total = 0;
+	for (int i = 0; i < iovcnt; i++) {
+		total += iov[i].iov_len;
+		if (iov[i].iov_len > INT_MAX || total > INT_MAX) {
+			free (iov);
+			return NULL;
+		}
+	}
+	for (int i = 0; i < iovcnt; i++)
+		if (!pin_buffer (iov[i].iov_base, iov[i].iov_len, rsp, to_write)) {
+			release_iovec (iov, i);
+			exit (-1);
+		}
+	return iov;
+}
+
+/* Reads from FD into the IOVCNT buffers at UIOV, in order, as if by one
+ * read() into their concatenation. Every buffer is checked before any
+ * data moves, and a file is read under one hold of filesys_lock. Returns
+ * the number of bytes read, or -1 on error. */
+static int
+readv (int fd, const struct iovec *uiov, int iovcnt, void *rsp)
+{
+	struct file *file_obj = process_get_file (fd);
+	if (file_obj == NULL)
+		return -1;
+	struct iovec *iov = copy_in_iovec (uiov, iovcnt, rsp, true);
+	if (iov == NULL)
+		return -1;
+
+	int total = 0;
+	bool locked = get_seekable_file (fd) != NULL;
+	if (locked)
+		lock_acquire (&filesys_lock);
+	for (int i = 0; i < iovcnt; i++) {
+		int n = locked ? file_read (file_obj, iov[i].iov_base, iov[i].iov_len)
+			: read (fd, iov[i].iov_base, iov[i].iov_len);
+		if (n < 0) {
+			if (total == 0)
+				total = -1;
+			break;
+		}
+		total += n;
+		if ((size_t) n < iov[i].iov_len)
+			break;
+	}
+	if (locked)
+		lock_release (&filesys_lock);
+
+	release_iovec (iov, iovcnt);
+	return total;
+}
+
+/* Writes the IOVCNT buffers at UIOV to FD, in order, as if by one
+ * write() of their concatenation. Every buffer is checked before any
+ * data moves, and a file is written under one hold of filesys_lock.
+ * Returns the number of bytes written, or -1 on error. */
+static int
+writev (int fd, const struct iovec *uiov, int iovcnt, void *rsp)
+{
+	struct file *file_obj = process_get_file (fd);
+	if (file_obj == NULL)
+		return -1;
+	struct iovec *iov = copy_in_iovec (uiov, iovcnt, rsp, false);
+	if (iov == NULL)
+		return -1;
+
+	int total = 0;
+	bool locked = get_seekable_file (fd) != NULL;
+	if (locked)
+		lock_acquire (&filesys_lock);
+	for (int i = 0; i < iovcnt; i++) {
+		int n = locked ? file_write (file_obj, iov[i].iov_base, iov[i].iov_len)
+			: write (fd, iov[i].iov_base, iov[i].iov_len);
+		if (n < 0) {
+			if (total == 0)
+				total = -1;
+			break;
+		}
+		total += n;
+		if ((size_t) n < iov[i].iov_len)
+			break;
+	}
+	if (locked)
+		lock_release (&filesys_lock);
+
+	release_iovec (iov, iovcnt);
+	return total;
+}
+
+/* Copies LENGTH bytes from IN_FD at IN_OFF to OUT_FD at OUT_OFF inside
+ * the kernel, through one page of kernel memory and without touching
+ * user memory. An offset of -1 means the file's own position, which is
+ * then advanced. OUT_FD may be the console, which ignores OUT_OFF. Each
+ * chunk but the first starts on a sector boundary of the input, so the
+ * reads do not straddle sectors needlessly. Stops at the end of the
+ * input or at a short write. Returns the number of bytes copied, or -1
+ * if a descriptor or offset is bad. */
+static int
+copy_file_range (int in_fd, off_t in_off, int out_fd, off_t out_off,
+		unsigned length)
+{
+	struct file *in = get_seekable_file (in_fd);
+	struct file *out = process_get_file (out_fd);
+	bool to_console = (uintptr_t) out == (uintptr_t) STDOUT;
+
+	if (!to_console)
+		out = get_seekable_file (out_fd);
+	if (in == NULL || out == NULL
+			|| in_off < -1 || (!to_console && out_off < -1)
+			|| length > INT_MAX)
+		return -1;
+
+	char *buf = palloc_get_page (0);
+	if (buf == NULL)
+		return -1;
+
+	lock_acquire (&filesys_lock);
+	off_t in_pos = in_off == -1 ? file_tell (in) : in_off;
+	off_t out_pos = to_console || out_off != -1 ? out_off : file_tell (out);
+	int total = 0;
+	while ((unsigned) total < length) {
+		size_t chunk = PGSIZE - in_pos % DISK_SECTOR_SIZE;
+		chunk = MIN (chunk, length - total);
+
+		off_t n = file_read_at (in, buf, chunk, in_pos);
+		if (n <= 0)
+			break;
+
+		off_t written = n;
+		if (to_console)
+			putbuf (buf, n);
+		else {
+			written = file_write_at (out, buf, n, out_pos);
+			out_pos += MAX (written, 0);
+		}
+		total += MAX (written, 0);
+		in_pos += MAX (written, 0);
+		if (written < n || (size_t) n < chunk)
+			break;
+	}
+	if (in_off == -1)
+		file_seek (in, in_pos);
+	if (!to_console && out_off == -1)
+		file_seek (out, out_pos);
+	lock_release (&filesys_lock);
+
+	palloc_free_page (buf);
+	return total;
+}
+
+/* Kernel copy of the arguments of spawn(), which fits in a page. */
+struct spawn_request {
+	char *argv[SPAWN_ARGS_MAX + 1];
+	struct spawn_action actions[SPAWN_ACTIONS_MAX];
+	char strings[2048];     /* The path, then the arguments. */
+};
+
+/* Starts PATH in a new child process with the null-terminated argument
+ * list ARGV. The child inherits this process's descriptors, changed by
+ * FD_ACTIONS, a list ending with SPAWN_END that may be NULL. Exits if a
+ * pointer is bad. Returns the child's pid, or -1 if the program cannot
+ * be started or the lists are too long. */
+static tid_t
+spawn (const char *path, char *const argv[],
+		const struct spawn_action *fd_actions)
+{
+	struct spawn_request *req = palloc_get_page (0);
+	size_t used = 0, action_cnt = 0;
+	int argc = 0, len;
+	tid_t pid = -1;
+
+	if (req == NULL)
+		return -1;
+
+	len = strncpy_from_user (req->strings, path, sizeof req->strings);
+	if (len < 0)
+		goto bad;
+	used = len + 1;
+
+	for (;; argc++) {
+		char *arg;
+		if (copy_from_user (&arg, &argv[argc], sizeof arg) != 0)
+			goto bad;
+		if (arg == NULL)
+			break;
+		if (argc == SPAWN_ARGS_MAX || used >= sizeof req->strings)
+			goto done;
+		len = strncpy_from_user (req->strings + used, arg,
+				sizeof req->strings - used);
+		if (len < 0)
+			goto bad;
+		req->argv[argc] = req->strings + used;
+		used += len + 1;
+	}
+	if (argc == 0 || used > sizeof req->strings)
+		goto done;
+	req->argv[argc] = NULL;
+
+	for (; fd_actions != NULL; action_cnt++) {
+		if (action_cnt == SPAWN_ACTIONS_MAX)
+			goto done;
+		struct spawn_action *a = &req->actions[action_cnt];
+		if (copy_from_user (a, &fd_actions[action_cnt], sizeof *a) != 0)
+			goto bad;
+		if (a->op == SPAWN_END)
+			break;
+	}
+
+	pid = process_spawn (req->strings, req->argv, argc, req->actions,
+			action_cnt);
+done:
+	palloc_free_page (req);
+	return pid;
+
+bad:
+	palloc_free_page (req);
+	exit (-1);
+}
+
+/* Creates a pipe and stores descriptors for its reading and writing
+ * ends in FDS[0] and FDS[1]. Exits if FDS is a bad pointer. Returns 0,
+ * or -1 if memory or descriptors are short. */
+static int
+pipe (int *fds)
+{
+	struct file *reader, *writer;
+	int kfds[2];
+
+	if (!pipe_create (&reader, &writer))
+		return -1;
+	kfds[0] = process_add_file (reader);
+	kfds[1] = kfds[0] == -1 ? -1 : process_add_file (writer);
+	if (kfds[1] == -1) {
+		if (kfds[0] != -1)
+			process_close_file (kfds[0]);
+		file_close (reader);
+		file_close (writer);
+		return -1;
+	}
+
+	if (copy_to_user (fds, kfds, sizeof kfds) != 0)
+		exit (-1);
+	return 0;
+}
+
+/* Waits for child PID, or any child if PID is -1, and stores its exit
+ * status in *STATUS unless STATUS is null. Returns the child's pid, 0 if
+ * WNOHANG is given and no such child has exited yet, or -1 if there is
+ * no such child or OPTIONS is invalid. */
+static tid_t
+waitpid (tid_t pid, int *status, int options)
+{
+	int kstatus;
+
+	if (options & ~WNOHANG)
+		return -1;
+	pid = process_waitpid (pid, &kstatus, options);
+	if (pid > 0 && status != NULL
+			&& copy_to_user (status, &kstatus, sizeof kstatus) != 0)
+		exit (-1);
+	return pid;
 }
\ No newline at end of file
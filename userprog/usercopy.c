@@ -0,0 +1,100 @@
+/* usercopy.c: Copying data between the kernel and user memory.
+
+   The routines here touch user memory without checking it first.  A
+   page fault they take is handled like any other: the page is brought
+   in if it can be, and the access is retried.  If it cannot, page_fault()
+   finds the faulting instruction in the exception table and resumes at
+   its fixup address, so the copy stops and reports how far it got.
+   Valid pointers thus cost nothing extra and bad ones cost one fault. */
+
+#include "userprog/usercopy.h"
+#include <string.h>
+#include "threads/vaddr.h"
+
+/* Instruction that may fault on a user address, and where to resume if
+   the fault cannot be resolved. */
+struct exception_table_entry {
+	uintptr_t insn;
+	uintptr_t fixup;
+};
+
+/* Bounds of the exception table, provided by the linker script. */
+extern const struct exception_table_entry __start_ex_table[];
+extern const struct exception_table_entry __stop_ex_table[];
+
+/* Returns true if [UADDR, UADDR + SIZE) lies in user space. */
+static bool
+user_range_ok (const void *uaddr, size_t size) {
+	uintptr_t start = (uintptr_t) uaddr;
+	return start + size >= start && is_user_vaddr (uaddr)
+		&& (size == 0 || is_user_vaddr (uaddr + size - 1));
+}
+
+/* Copies SIZE bytes from SRC to DST, one of which is in user space.
+   Returns the number of bytes not copied, which is nonzero only if a
+   user page could not be brought in.  A fault leaves RCX holding the
+   remaining count, so the fixup is simply the next instruction. */
+static size_t
+copy_user (void *dst, const void *src, size_t size) {
+	asm volatile ("1: rep movsb\n"
+			"2:\n"
+			".pushsection .ex_table, \"a\"\n"
+			".quad 1b, 2b\n"
+			".popsection\n"
+			: "+D" (dst), "+S" (src), "+c" (size) : : "memory");
+	return size;
+}
+
+/* Copies SIZE bytes from user address USRC to DST.  Returns the number
+   of bytes that could not be copied. */
+size_t
+copy_from_user (void *dst, const void *usrc, size_t size) {
+	if (!user_range_ok (usrc, size))
+		return size;
+	return copy_user (dst, usrc, size);
+}
+
+/* Copies SIZE bytes from SRC to user address UDST.  Returns the number
+   of bytes that could not be copied. */
+size_t
+copy_to_user (void *udst, const void *src, size_t size) {
+	if (!user_range_ok (udst, size))
+		return size;
+	return copy_user (udst, src, size);
+}
+
+/* Copies the null-terminated user string USRC into DST, which has room
+   for SIZE bytes.  Returns the length of the string, SIZE if it does
+   not fit (DST is then not terminated), or -1 if USRC is bad.  Reads
+   at most one page at a time, so it never touches pages past the
+   terminator. */
+int
+strncpy_from_user (char *dst, const char *usrc, size_t size) {
+	size_t len = 0;
+
+	while (len < size) {
+		const char *src = usrc + len;
+		size_t chunk = PGSIZE - pg_ofs (src);
+		if (chunk > size - len)
+			chunk = size - len;
+		if (copy_from_user (dst + len, src, chunk) != 0)
+			return -1;
+
+		char *nul = memchr (dst + len, '\0', chunk);
+		if (nul != NULL)
+			return nul - dst;
+		len += chunk;
+	}
+	return size;
+}
+
+/* Returns the address to resume at after an unresolvable page fault at
+   RIP, or 0 if RIP is not in a user copy routine. */
+uintptr_t
+usercopy_fixup (uintptr_t rip) {
+	for (const struct exception_table_entry *e = __start_ex_table;
+			e < __stop_ex_table; e++)
+		if (e->insn == rip)
+			return e->fixup;
+	return 0;
+}
@@ -14,6 +14,8 @@ static void anon_destroy (struct page *page);
 
 
 struct bitmap *swap_table;
+/* Guards SWAP_TABLE, since pages are swapped by several threads at once. */
+static struct lock swap_lock;
 const size_t SECTORS_PER_PAGE = PGSIZE / DISK_SECTOR_SIZE;
 
 /* DO NOT MODIFY this struct */
@@ -39,6 +41,48 @@ vm_anon_init (void) {
 	swap_disk = disk_get(1, 1);
   	size_t swap_size = disk_size(swap_disk) / SECTORS_PER_PAGE;
   	swap_table = bitmap_create(swap_size);
+	lock_init (&swap_lock);
+}
+
+/* Returns the number of free swap slots. */
+size_t
+anon_swap_free_cnt (void) {
+	return bitmap_count (swap_table, 0, bitmap_size (swap_table), false);
+}
+
+/* Writes the page at KVA to a free swap slot and returns the slot. */
+size_t
+anon_swap_write (const void *kva) {
+	lock_acquire (&swap_lock);
+	size_t swap_slot_idx = bitmap_scan_and_flip (swap_table, 0, 1, false);
+	lock_release (&swap_lock);
+	if (swap_slot_idx == BITMAP_ERROR)
+		PANIC("There is no free swap slot!");
+
+	for (int i = 0; i < SECTORS_PER_PAGE; i++) {
+		disk_sector_t sec_no = (disk_sector_t) (swap_slot_idx * SECTORS_PER_PAGE) + i;
+		disk_write (swap_disk, sec_no, kva + i * DISK_SECTOR_SIZE);
+	}
+	return swap_slot_idx;
+}
+
+/* Reads swap slot SWAP_SLOT_IDX into the page at KVA and frees the
+ * slot. */
+void
+anon_swap_read (size_t swap_slot_idx, void *kva) {
+	for (int i = 0; i < SECTORS_PER_PAGE; i++) {
+		disk_sector_t sec_no = (disk_sector_t) (swap_slot_idx * SECTORS_PER_PAGE) + i;
+		disk_read (swap_disk, sec_no, kva + i * DISK_SECTOR_SIZE);
+	}
+	anon_swap_discard (swap_slot_idx);
+}
+
+/* Frees swap slot SWAP_SLOT_IDX without reading it. */
+void
+anon_swap_discard (size_t swap_slot_idx) {
+	lock_acquire (&swap_lock);
+	bitmap_set (swap_table, swap_slot_idx, false);
+	lock_release (&swap_lock);
 }
 
 /* Initialize the file mapping */
@@ -59,16 +103,9 @@ anon_swap_in (struct page *page, void *kva) {
 	struct anon_page *anon_page = &page->anon;
 	if (anon_page->swap_slot_idx == INVALID_SLOT_IDX) return false;
 
-	disk_sector_t sec_no;
-	// Read page from disk with sector size chunk
-	for (int i = 0; i < SECTORS_PER_PAGE; i++) {
-		// convert swap slot index to reading sector number
-		sec_no = (disk_sector_t) (anon_page->swap_slot_idx * SECTORS_PER_PAGE) + i;
-		off_t ofs = i * DISK_SECTOR_SIZE;
-		disk_read (swap_disk, sec_no, kva+ofs);
-	}
-	// Clear swap table
-	bitmap_set (swap_table, anon_page->swap_slot_idx, false);
+	anon_swap_read (anon_page->swap_slot_idx, kva);
+	thread_current ()->rusage.swapin++;
+	thread_current ()->rusage.inblock++;
 
 	anon_page->swap_slot_idx = INVALID_SLOT_IDX;
 
@@ -80,28 +117,17 @@ static bool
 anon_swap_out (struct page *page) {
 	struct anon_page *anon_page = &page->anon;
 
-	// Get swap slot index from swap table
-	size_t swap_slot_idx = bitmap_scan_and_flip (swap_table, 0, 1, false);
-	if (swap_slot_idx == BITMAP_ERROR)
-		PANIC("There is no free swap slot!");
-
-	// Copy page frame content to swap_slot
 	if (page == NULL || page->frame == NULL || page->frame->kva == NULL)
 		return false;
 
-	disk_sector_t sec_no;
-	// Write page to disk with sector size chunk
-	for (int i = 0; i < SECTORS_PER_PAGE; i++) {
-		// convert swap slot index to writing sector number
-		sec_no = (disk_sector_t) (swap_slot_idx * SECTORS_PER_PAGE) + i;
-		off_t ofs = i * DISK_SECTOR_SIZE;
-		disk_write (swap_disk, sec_no, page->frame->kva + ofs);
-	}
-	anon_page->swap_slot_idx = swap_slot_idx;
-
-	// Set "not present" to page, and clear.
+	/* Set "not present" first: a store by the owner during the write
+	 * then faults and waits for the page instead of being lost. */
 	pml4_clear_page (anon_page->owner->pml4, page->va);
 	pml4_set_dirty (anon_page->owner->pml4, page->va, false);
+
+	anon_page->swap_slot_idx = anon_swap_write (page->frame->kva);
+	anon_page->owner->rusage.swapout++;
+	anon_page->owner->rusage.oublock++;
 	page->frame = NULL;
 
 	return true;
@@ -113,15 +139,16 @@ anon_destroy (struct page *page) {
 	// struct anon_page *anon_page = &page->anon;
 
 	if (page -> frame!= NULL){
-		list_remove (&page->frame->frame_elem);
-		free(page->frame);
+		/* Unmap now, so that a discarded page faults in afresh. */
+		pml4_clear_page (thread_current ()->pml4, page->va);
+		palloc_free_page (page->frame->kva);
+		vm_remove_frame (page->frame);
 	}
 	else {
-		// Swapped anon page case
+		// Swapped anon page case. A page whose first load failed, see
+		// vm_map_frame(), has no slot either.
 		struct anon_page *anon_page = &page->anon;
-		ASSERT (anon_page->swap_slot_idx != INVALID_SLOT_IDX);
-
-		// Clear swap table
-		bitmap_set (swap_table, anon_page->swap_slot_idx, false);
+		if (anon_page->swap_slot_idx != INVALID_SLOT_IDX)
+			anon_swap_discard (anon_page->swap_slot_idx);
 	}
 }
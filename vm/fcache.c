@@ -0,0 +1,608 @@
+/* fcache.c: Cache of read-only file pages shared between processes.
+ *
+ * Non-writable ELF segments of the same executable are mapped to the same
+ * physical frame in every process that runs it, instead of each process
+ * reading its own copy. A cached frame is keyed by inode, page offset and
+ * the number of file bytes in the page, and is reference counted by the
+ * pages that map it. Frames nobody maps stay cached on an LRU list, so the
+ * next exec of the binary finds them, until vm_get_frame() reclaims them
+ * before it evicts anyone's pages. Mapped frames are kept off the eviction
+ * clock, like shared memory, and fcache_reclaim() sweeps them with a clock
+ * of its own once no unmapped frame is left: a frame none of its mappers
+ * has accessed since the last sweep is unmapped from all of them and
+ * dropped. Text is never dirty, so the pages are simply read again on the
+ * next fault.
+ *
+ * The cache doubles as a read-ahead buffer: fcache_prefetch() queues
+ * pages that a "readahead" thread reads in the background, and the lazy
+ * loaders copy from the cache when the page is there. */
+
+#include "vm/vm.h"
+#include "vm/fcache.h"
+#include <hash.h>
+#include <list.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include "filesys/inode.h"
+#include "threads/malloc.h"
+#include "threads/mmu.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "userprog/syscall.h"
+
+/* A file with cached pages. Holds a reference to the inode while any
+ * of its pages is cached, so a cached binary survives between runs. */
+struct fcache_file {
+	struct inode *inode;
+	struct list entries;            /* Cached fcache_entry's. */
+	struct hash_elem elem;          /* Element in `files'. */
+};
+
+/* One cached page. */
+struct fcache_entry {
+	struct fcache_file *file;       /* Owner, NULL once invalidated. */
+	off_t ofs;                      /* Page-aligned offset in the file. */
+	size_t read_bytes;              /* File bytes in the page, rest is 0. */
+	struct frame frame;             /* Holds the data, FRAME.page is NULL. */
+	int ref_cnt;                    /* References, one per mapping page. */
+	struct list mappers;            /* text_page's mapping FRAME. */
+	bool prefetched;                /* Read ahead and not used yet. */
+
+	struct hash_elem hash_elem;     /* Element in `entries'. */
+	struct list_elem file_elem;     /* Element in FILE's entries list. */
+	struct list_elem lru_elem;      /* In `idle_list' if unused, otherwise
+	                                   in `busy_list'. */
+};
+
+static struct hash files;           /* fcache_file's, keyed by inode. */
+static struct hash entries;         /* fcache_entry's, keyed by page. */
+static struct list idle_list;       /* Unmapped entries, oldest first. */
+static struct list busy_list;       /* Referenced entries, in sweep order. */
+static struct lock fcache_lock;
+
+/* A page waiting to be read ahead. */
+struct prefetch {
+	struct inode *inode;            /* Reopened, closed once read. */
+	off_t ofs;
+	size_t read_bytes;
+	struct list_elem elem;
+};
+
+/* Requests beyond this many queued ones are dropped. */
+#define PREFETCH_MAX 64
+
+static struct list prefetch_list;   /* Queued prefetch's, oldest first. */
+static size_t prefetch_cnt;         /* Length of `prefetch_list'. */
+static struct semaphore prefetch_sema;  /* Counts queued requests. */
+static unsigned invalidate_cnt;     /* Calls to fcache_invalidate(). */
+
+/* Statistics. */
+static long long prefetch_reads;    /* Pages cached by the readahead thread. */
+static long long prefetch_hits;     /* Of those, pages later used. */
+
+static void prefetcher (void *aux);
+
+static bool fcache_swap_in (struct page *page, void *kva);
+static bool fcache_swap_out (struct page *page);
+static void fcache_destroy (struct page *page);
+
+/* Cached frames are never on the eviction clock, so swap_in and
+ * swap_out are not reachable; fcache_reclaim() unmaps them instead. */
+static const struct page_operations fcache_ops = {
+	.swap_in = fcache_swap_in,
+	.swap_out = fcache_swap_out,
+	.destroy = fcache_destroy,
+	.type = VM_ANON | VM_TEXT,
+};
+
+static uint64_t
+file_hash (const struct hash_elem *e, void *aux UNUSED) {
+	const struct fcache_file *f = hash_entry (e, struct fcache_file, elem);
+	return hash_bytes (&f->inode, sizeof f->inode);
+}
+
+static bool
+file_less (const struct hash_elem *a_, const struct hash_elem *b_,
+		void *aux UNUSED) {
+	const struct fcache_file *a = hash_entry (a_, struct fcache_file, elem);
+	const struct fcache_file *b = hash_entry (b_, struct fcache_file, elem);
+	return a->inode < b->inode;
+}
+
+static uint64_t
+entry_hash (const struct hash_elem *e, void *aux UNUSED) {
+	const struct fcache_entry *p = hash_entry (e, struct fcache_entry,
+			hash_elem);
+	uint64_t h = hash_bytes (&p->file, sizeof p->file);
+	h = h * 31 + hash_bytes (&p->ofs, sizeof p->ofs);
+	return h * 31 + hash_bytes (&p->read_bytes, sizeof p->read_bytes);
+}
+
+static bool
+entry_less (const struct hash_elem *a_, const struct hash_elem *b_,
+		void *aux UNUSED) {
+	const struct fcache_entry *a = hash_entry (a_, struct fcache_entry,
+			hash_elem);
+	const struct fcache_entry *b = hash_entry (b_, struct fcache_entry,
+			hash_elem);
+	if (a->file != b->file)
+		return a->file < b->file;
+	if (a->ofs != b->ofs)
+		return a->ofs < b->ofs;
+	return a->read_bytes < b->read_bytes;
+}
+
+void
+fcache_init (void) {
+	hash_init (&files, file_hash, file_less, NULL);
+	hash_init (&entries, entry_hash, entry_less, NULL);
+	list_init (&idle_list);
+	list_init (&busy_list);
+	lock_init (&fcache_lock);
+	list_init (&prefetch_list);
+	prefetch_cnt = 0;
+	sema_init (&prefetch_sema, 0);
+	thread_create ("readahead", PRI_DEFAULT, prefetcher, NULL);
+}
+
+/* Returns the file record of INODE, or NULL. */
+static struct fcache_file *
+find_file (struct inode *inode) {
+	struct fcache_file key;
+	key.inode = inode;
+	struct hash_elem *e = hash_find (&files, &key.elem);
+	return e != NULL ? hash_entry (e, struct fcache_file, elem) : NULL;
+}
+
+/* Returns the cached page OFS/READ_BYTES of FILE, or NULL. */
+static struct fcache_entry *
+find_entry (struct fcache_file *file, off_t ofs, size_t read_bytes) {
+	struct fcache_entry key;
+	key.file = file;
+	key.ofs = ofs;
+	key.read_bytes = read_bytes;
+	struct hash_elem *e = hash_find (&entries, &key.hash_elem);
+	return e != NULL ? hash_entry (e, struct fcache_entry, hash_elem) : NULL;
+}
+
+/* Takes a reference to ENTRY. */
+static void
+entry_get (struct fcache_entry *entry) {
+	if (entry->ref_cnt++ == 0) {
+		list_remove (&entry->lru_elem);
+		list_push_back (&busy_list, &entry->lru_elem);
+	}
+}
+
+/* Drops a reference to ENTRY, with fcache_lock held. */
+static void
+entry_put (struct fcache_entry *entry) {
+	ASSERT (entry->ref_cnt > 0);
+	if (--entry->ref_cnt == 0) {
+		list_remove (&entry->lru_elem);
+		if (entry->file != NULL)
+			list_push_back (&idle_list, &entry->lru_elem);
+		else {
+			palloc_free_page (entry->frame.kva);
+			free (entry);
+		}
+	}
+}
+
+/* Unlinks ENTRY from the cache. It is freed by the caller, or by the
+ * last fcache_release() if pages still map it. If that was the last
+ * cached page of its file, returns the inode whose reference the caller
+ * must drop once it has released fcache_lock, since closing an inode may
+ * write to the disk and come back here through fcache_invalidate(). */
+static struct inode *
+entry_unlink (struct fcache_entry *entry) {
+	struct fcache_file *file = entry->file;
+	struct inode *inode = NULL;
+
+	hash_delete (&entries, &entry->hash_elem);
+	list_remove (&entry->file_elem);
+	entry->file = NULL;
+	if (list_empty (&file->entries)) {
+		hash_delete (&files, &file->elem);
+		inode = file->inode;
+		free (file);
+	}
+	return inode;
+}
+
+static struct fcache_entry *
+frame_to_entry (struct frame *frame) {
+	return (struct fcache_entry *) ((uint8_t *) frame
+			- offsetof (struct fcache_entry, frame));
+}
+
+/* Looks up page OFS of INODE holding READ_BYTES bytes of file data.
+ * Returns the entry with a new reference taken, or NULL on a miss. */
+struct fcache_entry *
+fcache_lookup (struct inode *inode, off_t ofs, size_t read_bytes) {
+	struct fcache_entry *entry = NULL;
+
+	lock_acquire (&fcache_lock);
+	struct fcache_file *file = find_file (inode);
+	if (file != NULL)
+		entry = find_entry (file, ofs, read_bytes);
+	if (entry != NULL) {
+		entry_get (entry);
+		if (entry->prefetched) {
+			entry->prefetched = false;
+			prefetch_hits++;
+		}
+	}
+	lock_release (&fcache_lock);
+	return entry;
+}
+
+/* Caches KVA, a user page already filled with page OFS of INODE, and
+ * returns its entry with one reference taken. If another process cached
+ * the same page in the meantime, returns that entry instead and the
+ * caller keeps ownership of KVA. Returns NULL if out of memory. */
+struct fcache_entry *
+fcache_insert (struct inode *inode, off_t ofs, size_t read_bytes,
+		void *kva) {
+	struct fcache_entry *entry = NULL;
+
+	lock_acquire (&fcache_lock);
+	struct fcache_file *file = find_file (inode);
+	if (file != NULL && (entry = find_entry (file, ofs, read_bytes)) != NULL) {
+		entry_get (entry);
+		goto done;
+	}
+
+	if (file == NULL) {
+		file = malloc (sizeof *file);
+		if (file == NULL)
+			goto done;
+		file->inode = inode_reopen (inode);
+		inode_set_cached (inode);
+		list_init (&file->entries);
+		hash_insert (&files, &file->elem);
+	}
+
+	entry = malloc (sizeof *entry);
+	if (entry == NULL) {
+		if (list_empty (&file->entries)) {
+			hash_delete (&files, &file->elem);
+			inode_close (file->inode);
+			free (file);
+		}
+		goto done;
+	}
+	entry->file = file;
+	entry->ofs = ofs;
+	entry->read_bytes = read_bytes;
+	entry->frame.kva = kva;
+	entry->frame.page = NULL;
+	entry->frame.owner = NULL;
+	entry->frame.pin_cnt = 0;
+	entry->ref_cnt = 1;
+	list_init (&entry->mappers);
+	entry->prefetched = false;
+	hash_insert (&entries, &entry->hash_elem);
+	list_push_back (&file->entries, &entry->file_elem);
+	list_push_back (&busy_list, &entry->lru_elem);
+
+done:
+	lock_release (&fcache_lock);
+	return entry;
+}
+
+/* Copies page OFS/READ_BYTES of INODE into KVA and returns true if it
+ * is cached, otherwise returns false. */
+bool
+fcache_copy (struct inode *inode, off_t ofs, size_t read_bytes, void *kva) {
+	struct fcache_entry *entry = fcache_lookup (inode, ofs, read_bytes);
+	if (entry == NULL)
+		return false;
+	memcpy (kva, entry->frame.kva, PGSIZE);
+	fcache_release (entry);
+	return true;
+}
+
+/* Asks the readahead thread to cache page OFS of INODE holding
+ * READ_BYTES bytes of file data. Does nothing if the page is cached
+ * already or too many requests are pending. */
+void
+fcache_prefetch (struct inode *inode, off_t ofs, size_t read_bytes) {
+	struct prefetch *req = NULL;
+
+	lock_acquire (&fcache_lock);
+	struct fcache_file *file = find_file (inode);
+	if ((file == NULL || find_entry (file, ofs, read_bytes) == NULL)
+			&& prefetch_cnt < PREFETCH_MAX
+			&& (req = malloc (sizeof *req)) != NULL) {
+		/* Before the read, so that a write racing with it bumps
+		 * `invalidate_cnt'. */
+		inode_set_cached (inode);
+		req->inode = inode_reopen (inode);
+		req->ofs = ofs;
+		req->read_bytes = read_bytes;
+		list_push_back (&prefetch_list, &req->elem);
+		prefetch_cnt++;
+	}
+	lock_release (&fcache_lock);
+	if (req != NULL)
+		sema_up (&prefetch_sema);
+}
+
+/* Reads queued pages into the cache. Never evicts: a request is dropped
+ * if no free user page is left. */
+static void
+prefetcher (void *aux UNUSED) {
+	for (;;) {
+		sema_down (&prefetch_sema);
+		lock_acquire (&fcache_lock);
+		struct prefetch *req = list_entry (list_pop_front (&prefetch_list),
+				struct prefetch, elem);
+		prefetch_cnt--;
+		unsigned invalidated = invalidate_cnt;
+		lock_release (&fcache_lock);
+
+		void *kva = palloc_get_page (PAL_USER);
+		if (kva != NULL) {
+			lock_acquire (&filesys_lock);
+			off_t n = inode_read_at (req->inode, kva, req->read_bytes, req->ofs);
+			lock_release (&filesys_lock);
+			memset (kva + n, 0, PGSIZE - n);
+
+			struct fcache_entry *entry = fcache_insert (req->inode, req->ofs,
+					req->read_bytes, kva);
+			if (entry == NULL || fcache_kva (entry) != kva)
+				palloc_free_page (kva);
+			else {
+				lock_acquire (&fcache_lock);
+				entry->prefetched = true;
+				prefetch_reads++;
+				lock_release (&fcache_lock);
+			}
+			if (entry != NULL)
+				fcache_release (entry);
+			/* A write that raced with the read may have left stale data. */
+			if (invalidate_cnt != invalidated)
+				fcache_invalidate (req->inode);
+		}
+		inode_close (req->inode);
+		free (req);
+	}
+}
+
+/* Prints read-ahead statistics. */
+void
+fcache_print_stats (void) {
+	printf ("Readahead: %lld pages read, %lld used (%lld%%)\n",
+			prefetch_reads, prefetch_hits,
+			prefetch_reads != 0 ? prefetch_hits * 100 / prefetch_reads : 0);
+}
+
+/* Returns the kernel address of ENTRY's frame. */
+void *
+fcache_kva (struct fcache_entry *entry) {
+	return entry->frame.kva;
+}
+
+/* Drops a reference to ENTRY. Unused entries stay cached unless they
+ * were invalidated meanwhile. */
+void
+fcache_release (struct fcache_entry *entry) {
+	lock_acquire (&fcache_lock);
+	entry_put (entry);
+	lock_release (&fcache_lock);
+}
+
+/* Returns the page that list element E of a mapper list belongs to. */
+static struct page *
+mapper_page (struct list_elem *e) {
+	struct text_page *tp = list_entry (e, struct text_page, elem);
+	return (struct page *) ((uint8_t *) tp - offsetof (struct page, text));
+}
+
+/* Returns true if a mapper of ENTRY accessed it since the last sweep,
+ * and clears the accessed bits for the next one. */
+static bool
+entry_accessed (struct fcache_entry *entry) {
+	bool accessed = false;
+
+	for (struct list_elem *e = list_begin (&entry->mappers);
+			e != list_end (&entry->mappers); e = list_next (e)) {
+		struct page *page = mapper_page (e);
+		uint64_t *pml4 = page->text.owner->pml4;
+		if (pml4_is_accessed (pml4, page->va)) {
+			pml4_set_accessed (pml4, page->va, false);
+			accessed = true;
+		}
+	}
+	return accessed;
+}
+
+/* Locks every page mapping ENTRY, see vm_lock_page(), or none of them if
+ * one is locked already. */
+static bool
+entry_try_lock (struct fcache_entry *entry) {
+	struct list_elem *e;
+
+	for (e = list_begin (&entry->mappers); e != list_end (&entry->mappers);
+			e = list_next (e))
+		if (!vm_try_lock_page (mapper_page (e)))
+			break;
+	if (e == list_end (&entry->mappers))
+		return true;
+	for (struct list_elem *f = list_begin (&entry->mappers); f != e;
+			f = list_next (f))
+		vm_unlock_page (mapper_page (f));
+	return false;
+}
+
+/* Unlocks every page mapping ENTRY. */
+static void
+entry_unlock (struct fcache_entry *entry) {
+	for (struct list_elem *e = list_begin (&entry->mappers);
+			e != list_end (&entry->mappers); e = list_next (e))
+		vm_unlock_page (mapper_page (e));
+}
+
+/* Goes once around `busy_list' and returns the first entry whose only
+ * references are its mappings, that none of its mappers accessed since
+ * the last sweep and that no mapper has pinned, with its mappers locked.
+ * Pins are checked once the mappers are locked, since they are taken
+ * with the page locked. Returns NULL if there is none. */
+static struct fcache_entry *
+entry_pick (void) {
+	for (size_t n = list_size (&busy_list); n > 0; n--) {
+		struct fcache_entry *entry = list_entry (list_pop_front (&busy_list),
+				struct fcache_entry, lru_elem);
+		list_push_back (&busy_list, &entry->lru_elem);
+		if ((size_t) entry->ref_cnt != list_size (&entry->mappers)
+				|| vm_frame_pinned (&entry->frame) || entry_accessed (entry)
+				|| !entry_try_lock (entry))
+			continue;
+		if (!vm_frame_pinned (&entry->frame))
+			return entry;
+		entry_unlock (entry);
+	}
+	return NULL;
+}
+
+/* Drops the least recently used unmapped page from the cache and
+ * returns its user page for reuse. If every cached page is in use,
+ * unmaps one that none of its mappers has used since the last sweep from
+ * all of them and drops that instead. Returns NULL if no page
+ * qualifies. */
+void *
+fcache_reclaim (void) {
+	struct fcache_entry *entry = NULL;
+	struct inode *inode = NULL;
+	void *kva = NULL;
+
+	lock_acquire (&fcache_lock);
+	if (!list_empty (&idle_list))
+		entry = list_entry (list_pop_front (&idle_list),
+				struct fcache_entry, lru_elem);
+	else if ((entry = entry_pick ()) != NULL) {
+		list_remove (&entry->lru_elem);
+		while (!list_empty (&entry->mappers)) {
+			struct page *page = mapper_page (list_pop_front (&entry->mappers));
+			pml4_clear_page (page->text.owner->pml4, page->va);
+			page->frame = NULL;
+			vm_unlock_page (page);
+		}
+		entry->ref_cnt = 0;
+	}
+	if (entry != NULL) {
+		if (entry->file != NULL)
+			inode = entry_unlink (entry);
+		kva = entry->frame.kva;
+		free (entry);
+	}
+	lock_release (&fcache_lock);
+	inode_close (inode);
+	return kva;
+}
+
+/* Forgets every cached page of INODE, whose contents just changed.
+ * Processes already mapping one keep the old data until they unmap it. */
+void
+fcache_invalidate (struct inode *inode) {
+	struct inode *closed = NULL;
+
+	lock_acquire (&fcache_lock);
+	invalidate_cnt++;
+	struct fcache_file *file = find_file (inode);
+	while (file != NULL) {
+		struct fcache_entry *entry = list_entry (list_front (&file->entries),
+				struct fcache_entry, file_elem);
+
+		closed = entry_unlink (entry);
+		if (entry->ref_cnt == 0) {
+			list_remove (&entry->lru_elem);
+			palloc_free_page (entry->frame.kva);
+			free (entry);
+		}
+		if (closed != NULL)
+			file = NULL;
+	}
+	lock_release (&fcache_lock);
+	inode_close (closed);
+}
+
+/* Maps ENTRY's frame into PAGE with fcache_lock held, see
+ * fcache_map_page(). */
+static bool
+entry_map (struct page *page, struct fcache_entry *entry, struct vma *vma) {
+	if (!pml4_set_page (thread_current ()->pml4, page->va,
+				entry->frame.kva, false)) {
+		entry_put (entry);
+		return false;
+	}
+	page->operations = &fcache_ops;
+	page->frame = &entry->frame;
+	page->text.vma = vma;
+	page->text.owner = thread_current ();
+	list_push_back (&entry->mappers, &page->text.elem);
+	return true;
+}
+
+/* Turns PAGE, a page of segment VMA, into a read-only mapping of ENTRY's
+ * frame, consuming the caller's reference to ENTRY. If PAGE cannot be
+ * mapped, it is left as it was and the reference is dropped. */
+bool
+fcache_map_page (struct page *page, struct fcache_entry *entry,
+		struct vma *vma) {
+	lock_acquire (&fcache_lock);
+	bool success = entry_map (page, entry, vma);
+	lock_release (&fcache_lock);
+	return success;
+}
+
+/* Maps DST, a fresh page of segment VMA in the current process, to the
+ * frame SRC maps. If that was reclaimed meanwhile, DST is left to be
+ * loaded on its first fault. */
+bool
+fcache_share_page (struct page *dst, struct page *src, struct vma *vma) {
+	bool success = true;
+
+	lock_acquire (&fcache_lock);
+	if (src->frame != NULL) {
+		struct fcache_entry *entry = frame_to_entry (src->frame);
+		entry_get (entry);
+		success = entry_map (dst, entry, vma);
+	}
+	lock_release (&fcache_lock);
+	return success;
+}
+
+/* Returns true if PAGE is a page of text, which maps a cached frame
+ * unless fcache_reclaim() took it. */
+bool
+fcache_is_text (struct page *page) {
+	return page->operations == &fcache_ops;
+}
+
+static bool
+fcache_swap_in (struct page *page UNUSED, void *kva UNUSED) {
+	return false;
+}
+
+static bool
+fcache_swap_out (struct page *page UNUSED) {
+	return false;
+}
+
+/* Unmaps PAGE so that pml4_destroy() leaves the shared frame alone, and
+ * drops its reference. PAGE will be freed by the caller. */
+static void
+fcache_destroy (struct page *page) {
+	lock_acquire (&fcache_lock);
+	if (page->frame != NULL) {
+		pml4_clear_page (page->text.owner->pml4, page->va);
+		list_remove (&page->text.elem);
+		entry_put (frame_to_entry (page->frame));
+		page->frame = NULL;
+	}
+	lock_release (&fcache_lock);
+}
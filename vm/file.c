@@ -3,9 +3,14 @@
 #include "vm/vm.h"
 #include "threads/vaddr.h"
 #include "vm/file.h"
+#include "vm/fcache.h"
 #include <string.h>
+#include <stdlib.h>
 #include "threads/malloc.h"
 #include "threads/mmu.h"
+#include "threads/synch.h"
+#include "devices/timer.h"
+#include "userprog/syscall.h"
 
 static bool file_backed_swap_in (struct page *page, void *kva);
 static bool file_backed_swap_out (struct page *page);
@@ -19,18 +24,23 @@ static const struct page_operations file_ops = {
 	.type = VM_FILE,
 };
 
-static struct list mmap_file_list;
+/* Dirty pages are written back by the flusher thread every
+ * FLUSH_INTERVAL ticks, FLUSH_BATCH pages at a time and at most
+ * FLUSH_MAX pages per round. */
+#define FLUSH_INTERVAL TIMER_FREQ
+#define FLUSH_BATCH 32
+#define FLUSH_MAX 256
 
-struct mmap_file_info{
-	struct list_elem elem;
-	uint64_t start;
-	uint64_t end;
-};
+static struct semaphore flusher_start;  /* Upped on the first mmap. */
+static bool flusher_running;
+
+static void flusher (void *aux);
 
 /* The initializer of file vm */
 void
 vm_file_init (void) {
-	list_init (&mmap_file_list);
+	sema_init (&flusher_start, 0);
+	thread_create ("flusher", PRI_DEFAULT, flusher, NULL);
 }
 
 /* Initialize the file backed page */
@@ -51,28 +61,54 @@ file_backed_swap_in (struct page *page, void *kva) {
 	struct file_page *file_page = &page->file;
 	if (file_page->file == NULL) return false;
 
-	file_seek (file_page->file, file_page->ofs);
-	off_t read_size = file_read (file_page->file, kva, file_page->size);
+	lock_acquire (&filesys_lock);
+	off_t read_size = file_read_at (file_page->file, kva, file_page->size,
+			file_page->ofs);
+	lock_release (&filesys_lock);
 	if (read_size != file_page->size) return false;
+	thread_current ()->rusage.inblock++;
 	if (read_size < PGSIZE)
 		memset (kva + read_size, 0, PGSIZE - read_size);
 	return true;
 }
 
-/* Swap out the page by writeback contents to the file. */
+/* Writes PAGE, which is present, back to its file if it is dirty in
+ * PML4. The dirty bit is cleared first, so a store that races with the
+ * write marks the page dirty again. PAGE must be locked, so that no one
+ * evicts or frees it meanwhile, and filesys_lock must be held. */
+static void
+file_page_writeback (struct page *page, uint64_t *pml4) {
+	struct file_page *file_page = &page->file;
+
+	ASSERT (page->busy);
+	ASSERT (lock_held_by_current_thread (&filesys_lock));
+	if (!pml4_is_dirty (pml4, page->va))
+		return;
+	pml4_set_dirty (pml4, page->va, false);
+	file_write_at (file_page->file, page->frame->kva, file_page->size,
+			file_page->ofs);
+	page->frame->owner->rusage.oublock++;
+}
+
+/* Swap out the page by writeback contents to the file. The page may
+ * belong to another process than the one evicting it. It is unmapped
+ * before the dirty bit is read, so a store by its owner either lands
+ * before and is written, or faults and waits for the page instead of
+ * being lost. The bit outlives the mapping. */
 static bool
 file_backed_swap_out (struct page *page) {
 	struct file_page *file_page = &page->file;
-	struct thread *curr = thread_current ();
-
-	if (pml4_is_dirty (curr->pml4, page->va)) {
-		file_seek (file_page->file, file_page->ofs);
-		file_write (file_page->file, page->va, file_page->size);
-		pml4_set_dirty (curr->pml4, page->va, false);
-	}
+	uint64_t *pml4 = page->frame->owner->pml4;
 
 	// Set "not present" to page, and clear.
-	pml4_clear_page (curr->pml4, page->va);
+	pml4_clear_page (pml4, page->va);
+	if (pml4_is_dirty (pml4, page->va)) {
+		lock_acquire (&filesys_lock);
+		file_write_at (file_page->file, page->frame->kva, file_page->size,
+				file_page->ofs);
+		lock_release (&filesys_lock);
+		page->frame->owner->rusage.oublock++;
+	}
 	page->frame = NULL;
 
 	return true;
@@ -81,30 +117,92 @@ file_backed_swap_out (struct page *page) {
 /* Destory the file backed page. PAGE will be freed by the caller. */
 static void
 file_backed_destroy (struct page *page) {
-	// TODO: On mmap_exit sometimes empty file content
-	struct file_page *file_page = &page->file;
-	//if dirty, write back to file
-	if (pml4_is_dirty (thread_current() -> pml4, page -> va)){
-		file_seek (file_page->file, file_page->ofs);
-		file_write (file_page->file, page->va, file_page->size);
-	}
-	file_close (file_page->file);
+	struct thread *curr = thread_current ();
+	struct frame *frame = page->frame;
+
+	if (frame == NULL)
+		return;
+	lock_acquire (&filesys_lock);
+	file_page_writeback (page, curr->pml4);
+	lock_release (&filesys_lock);
+	pml4_clear_page (curr->pml4, page->va);
+	palloc_free_page (frame->kva);
+	vm_remove_frame (frame);
+	page->frame = NULL;
+}
 
-	if (page->frame != NULL) {
-		list_remove (&page->frame->frame_elem);
-		free (page->frame);
+/* Returns true if FRAME holds a dirty mmap'd page. */
+static bool
+frame_is_dirty_file (struct frame *frame) {
+	struct page *page = frame->page;
+	return page != NULL && page->operations == &file_ops
+		&& frame->owner->pml4 != NULL
+		&& pml4_is_dirty (frame->owner->pml4, page->va);
+}
+
+/* Orders frames of file pages by file, then by offset. */
+static int
+frame_file_less (const void *a_, const void *b_) {
+	const struct file_page *a = &(*(struct frame **) a_)->page->file;
+	const struct file_page *b = &(*(struct frame **) b_)->page->file;
+	struct inode *ia = file_get_inode (a->file);
+	struct inode *ib = file_get_inode (b->file);
+
+	if (ia != ib)
+		return ia < ib ? -1 : 1;
+	return a->ofs < b->ofs ? -1 : a->ofs > b->ofs;
+}
+
+/* Writes back dirty mmap'd pages of every process, in batches sorted by
+ * file and offset so that neighbouring pages go out in one sweep. */
+static void
+flush_dirty_pages (void) {
+	struct frame *batch[FLUSH_BATCH];
+	size_t total = 0, cnt;
+
+	do {
+		cnt = vm_scan_frames (frame_is_dirty_file, batch, FLUSH_BATCH);
+		qsort (batch, cnt, sizeof *batch, frame_file_less);
+		lock_acquire (&filesys_lock);
+		for (size_t i = 0; i < cnt; i++) {
+			struct page *page = batch[i]->page;
+			file_page_writeback (page, batch[i]->owner->pml4);
+			vm_unlock_page (page);
+		}
+		lock_release (&filesys_lock);
+		total += cnt;
+	} while (cnt == FLUSH_BATCH && total < FLUSH_MAX);
+}
+
+/* Background writeback thread. Idle until the first mmap(). */
+static void
+flusher (void *aux UNUSED) {
+	sema_down (&flusher_start);
+	for (;;) {
+		timer_sleep (FLUSH_INTERVAL);
+		flush_dirty_pages ();
 	}
 }
 
 //project3 - mmf
-static bool
+bool
 lazy_load_file (struct page* page, void* aux){
 	struct mmap_info* mi = (struct mmap_info*) aux;
-	file_seek (mi->file, mi->offset);
-	page -> file.size = file_read (mi->file, page->va, mi->read_bytes);//여기서 load
+	/* Read-ahead may have cached the page already. */
+	if (fcache_copy (file_get_inode (mi->file), mi->offset, mi->read_bytes,
+				page->frame->kva)) {
+		off_t left = file_length (mi->file) - mi->offset;
+		page -> file.size = MIN ((size_t) MAX (left, 0), mi->read_bytes);
+	}
+	else {
+		lock_acquire (&filesys_lock);
+		page -> file.size = file_read_at (mi->file, page->frame->kva, mi->read_bytes, mi->offset);//여기서 load
+		lock_release (&filesys_lock);
+		thread_current ()->rusage.inblock++;
+	}
 	page -> file.ofs = mi->offset;
 	if (page->file.size != PGSIZE){
-		memset (page->va + page->file.size, 0, PGSIZE - page->file.size);
+		memset (page->frame->kva + page->file.size, 0, PGSIZE - page->file.size);
 	}
 	pml4_set_dirty (thread_current()->pml4, page->va, false);
 	free(mi);
@@ -116,39 +214,170 @@ lazy_load_file (struct page* page, void* aux){
 void *
 do_mmap (void *addr, size_t length, int writable,
 		struct file *file, off_t offset) {
-	off_t ofs;
-	uint64_t read_bytes;
-	for (uint64_t i = 0; i < length; i += PGSIZE){
-		struct mmap_info* mi = malloc (sizeof (struct mmap_info));
-		ofs = offset + i;
-		read_bytes = length - i >= PGSIZE ? PGSIZE : length -i;
-		mi->file = file_reopen (file);
-		mi->offset = ofs;
-		mi->read_bytes = read_bytes;
-		vm_alloc_page_with_initializer (VM_FILE, (void*) ((uint64_t) addr + i), writable, lazy_load_file, (void*) mi);
+	struct supplemental_page_table *spt = &thread_current ()->spt;
+
+	/* Pages are created on first access, see vma_alloc_page(). */
+	rwlock_acquire_write (&spt->lock);
+	struct vma *vma = vma_create (&spt->vmas, addr, length, file, offset,
+			length, writable, VMA_MMAP);
+	rwlock_release_write (&spt->lock);
+	if (vma == NULL)
+		return NULL;
+	if (!flusher_running) {
+		flusher_running = true;
+		sema_up (&flusher_start);
 	}
-	struct mmap_file_info* mfi = malloc (sizeof (struct mmap_file_info));
-	mfi->start = (uint64_t) addr;
-	mfi->end = (uint64_t) pg_round_down((uint64_t) addr + length -1);
-	list_push_back(&mmap_file_list, &mfi->elem);
 	return addr;
 }
 
-/* Do the munmap */
-void
+static int
+page_va_less (const void *a_, const void *b_) {
+	const struct page *a = *(struct page **) a_;
+	const struct page *b = *(struct page **) b_;
+	return a->va < b->va ? -1 : a->va > b->va;
+}
+
+/* Removes the pages of SPT in [START, END) in address order, which is
+ * file order within a mapping, so dirty pages go back to the disk as one
+ * sequential run. Walks whichever of the range and SPT is smaller. */
+static void
+mmap_remove_pages (struct supplemental_page_table *spt, void *start,
+		void *end) {
+	size_t cnt = hash_size (spt->pages);
+	struct page **pages = NULL;
+
+	if (cnt == 0)
+		return;
+	if ((size_t) (end - start) / PGSIZE > cnt)
+		pages = malloc (cnt * sizeof *pages);
+	if (pages == NULL) {
+		for (void *va = start; va < end; va += PGSIZE) {
+			struct page *page = spt_find_page (spt, va);
+			if (page != NULL)
+				spt_remove_page (spt, page);
+		}
+		return;
+	}
+
+	struct hash_iterator i;
+	size_t n = 0;
+	hash_first (&i, spt->pages);
+	while (hash_next (&i)) {
+		struct page *page = hash_entry (hash_cur (&i), struct page, hash_elem);
+		if (page->va >= start && page->va < end)
+			pages[n++] = page;
+	}
+	qsort (pages, n, sizeof *pages, page_va_less);
+	for (size_t k = 0; k < n; k++)
+		spt_remove_page (spt, pages[k]);
+	free (pages);
+}
+
+/* Points the already created pages of VMA, just split off another area,
+ * at VMA's own file handle. */
+static void
+mmap_rebind_pages (struct supplemental_page_table *spt, struct vma *vma) {
+	for (void *va = vma->start; va < vma->end; va += PGSIZE) {
+		struct page *page = spt_find_page (spt, va);
+		if (page == NULL)
+			continue;
+		if (page->operations->type == VM_UNINIT)
+			((struct mmap_info *) page->uninit.aux)->file = vma->file;
+		else
+			page->file.file = vma->file;
+	}
+}
+
+/* Unmaps every mmap'd page of the current process in [START, END),
+ * writing dirty pages back. Mappings that are only partly covered are
+ * trimmed, or split in two if the range falls in their middle. Returns
+ * false, with nothing unmapped, if such a split runs out of memory: the
+ * range then lies inside that one mapping. The address space must be
+ * locked for writing. */
+bool
+do_munmap_range (void *start, void *end) {
+	struct supplemental_page_table *spt = &thread_current ()->spt;
+	struct vma *vma;
+
+	while (start < end && (vma = vma_next (&spt->vmas, start)) != NULL
+			&& vma->start < end) {
+		void *lo = MAX (start, vma->start);
+		void *hi = MIN (end, vma->end);
+
+		start = hi;
+		if (!(vma->flags & VMA_MMAP))
+			continue;
+		if (lo > vma->start && hi < vma->end) {
+			struct vma *upper = vma_split (&spt->vmas, vma, hi);
+			if (upper == NULL)
+				return false;
+			/* Shared pages refer to the object, which both halves keep. */
+			if (!(upper->flags & VMA_SHARED))
+				mmap_rebind_pages (spt, upper);
+		}
+
+		mmap_remove_pages (spt, lo, hi);
+		if (lo == vma->start && hi == vma->end)
+			vma_destroy (&spt->vmas, vma);
+		else if (lo == vma->start)
+			vma_shrink (vma, hi, vma->end);
+		else
+			vma_shrink (vma, vma->start, lo);
+	}
+	return true;
+}
+
+/* Do the munmap. ADDR is normally the start of a mapping, which is then
+ * removed as a whole; a page inside a mapping unmaps it from there on.
+ * Returns false if nothing could be unmapped. */
+bool
 do_munmap (void *addr) {
-	if (list_empty (&mmap_file_list)) return;
-	for (struct list_elem* i = list_front (&mmap_file_list); i != list_end (&mmap_file_list); i = list_next (i))
-	{
-		struct mmap_file_info* mfi = list_entry (i, struct mmap_file_info, elem);
-		if (mfi -> start == (uint64_t) addr){
-			for (uint64_t j = (uint64_t)addr; j<= mfi -> end; j += PGSIZE){
-				struct page* page = spt_find_page(&thread_current() -> spt, (void*) j);
-				spt_remove_page(&thread_current()->spt, page);
-			}
-			list_remove(&mfi->elem);
-			free(mfi);
-			return;
+	struct supplemental_page_table *spt = &thread_current ()->spt;
+	bool success = false;
+
+	rwlock_acquire_write (&spt->lock);
+	struct vma *vma = vma_find (&spt->vmas, addr);
+	if (vma != NULL && (vma->flags & VMA_MMAP) && pg_ofs (addr) == 0)
+		success = do_munmap_range (addr, vma->end);
+	rwlock_release_write (&spt->lock);
+	return success;
+}
+
+/* Checks that [START, END) lies entirely in mmap'd areas of the current
+ * process and writes back its dirty pages. With SYNC false the pages are
+ * left to the flusher. */
+bool
+do_msync (void *start, void *end, bool sync) {
+	struct thread *curr = thread_current ();
+	struct vma_table *vmas = &curr->spt.vmas;
+
+	for (void *va = start; va < end; ) {
+		struct vma *vma = vma_find (vmas, va);
+		if (vma == NULL || !(vma->flags & VMA_MMAP))
+			return false;
+		va = vma->end;
+	}
+	if (!sync)
+		return true;
+
+	for (void *va = start; va < end; va += PGSIZE) {
+		struct page *page = spt_find_page (&curr->spt, va);
+		if (page == NULL)
+			continue;
+		vm_lock_page (page);
+		if (page->frame != NULL && page->operations == &file_ops) {
+			lock_acquire (&filesys_lock);
+			file_page_writeback (page, curr->pml4);
+			lock_release (&filesys_lock);
 		}
+		vm_unlock_page (page);
 	}
+	return true;
+}
+
+/* Unmaps all mappings of the current process, on exit or exec. Never
+ * fails, since whole mappings need no split. */
+void
+do_munmap_all (void) {
+	do_munmap_range (NULL, (void *) USER_STACK);
 }
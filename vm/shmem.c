@@ -0,0 +1,358 @@
+/* shmem.c: Anonymous memory shared between processes.
+ *
+ * mmap() with MAP_ANONYMOUS for the descriptor creates an object of
+ * zeroed pages and maps it. The area refers to the object, and so do its
+ * copies in the children fork() creates, so every process inheriting the
+ * area sees the same pages. The object goes away with its last area.
+ *
+ * Each page of an object has one frame, whichever process brings it in,
+ * and a list of the process pages that map it. Like cached text, shared
+ * frames are kept off the eviction clock. shmem_reclaim() sweeps them
+ * with a clock of its own instead: a frame no mapper has accessed since
+ * the last sweep is unmapped from all of them at once and written to
+ * swap, so the page leaves memory as one unit, and comes back as one on
+ * the next fault by any mapper. */
+
+#include "vm/vm.h"
+#include "vm/shmem.h"
+#include <round.h>
+#include <stddef.h>
+#include <string.h>
+#include "threads/malloc.h"
+#include "threads/mmu.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+
+/* A page of a shared object. */
+struct shmem_slot {
+	struct frame frame;             /* FRAME.kva is NULL unless resident. */
+	size_t swap_slot_idx;           /* Where it is while swapped out. */
+	struct list mappers;            /* shmem_page's mapping FRAME. */
+};
+
+/* A shared object. */
+struct shmem {
+	struct lock lock;               /* Guards the slots. */
+	int ref_cnt;                    /* Areas referring to the object. */
+	size_t page_cnt;
+	size_t hand;                    /* Next slot shmem_reclaim() looks at. */
+	struct list_elem elem;          /* Element in `objects'. */
+	struct shmem_slot slots[];
+};
+
+static struct list objects;         /* Every shmem, in reclaim order. */
+static struct lock objects_lock;
+
+static bool shmem_swap_in (struct page *page, void *kva);
+static bool shmem_swap_out (struct page *page);
+static void shmem_destroy (struct page *page);
+
+/* Shared frames are never on the eviction clock, so swap_in and
+ * swap_out are not reachable. */
+static const struct page_operations shmem_ops = {
+	.swap_in = shmem_swap_in,
+	.swap_out = shmem_swap_out,
+	.destroy = shmem_destroy,
+	.type = VM_ANON | VM_SHMEM,
+};
+
+void
+shmem_init (void) {
+	list_init (&objects);
+	lock_init (&objects_lock);
+}
+
+/* Creates an object of PAGE_CNT zeroed pages with one reference, or
+ * returns NULL if memory is short. */
+static struct shmem *
+shmem_create (size_t page_cnt) {
+	struct shmem *shm = malloc (sizeof *shm + page_cnt * sizeof *shm->slots);
+	if (shm == NULL)
+		return NULL;
+
+	lock_init (&shm->lock);
+	shm->ref_cnt = 1;
+	shm->page_cnt = page_cnt;
+	shm->hand = 0;
+	for (size_t i = 0; i < page_cnt; i++) {
+		struct shmem_slot *slot = &shm->slots[i];
+		slot->frame.kva = NULL;
+		slot->frame.page = NULL;
+		slot->frame.owner = NULL;
+		slot->frame.pin_cnt = 0;
+		slot->swap_slot_idx = INVALID_SLOT_IDX;
+		list_init (&slot->mappers);
+	}
+
+	lock_acquire (&objects_lock);
+	list_push_back (&objects, &shm->elem);
+	lock_release (&objects_lock);
+	return shm;
+}
+
+/* Maps LENGTH bytes of a new shared object at ADDR in the current
+ * process. Returns ADDR, or NULL if the area would overlap another one,
+ * is too large or memory is short. */
+void *
+shmem_mmap (void *addr, size_t length, bool writable) {
+	struct supplemental_page_table *spt = &thread_current ()->spt;
+	size_t page_cnt = DIV_ROUND_UP (length, PGSIZE);
+
+	if (page_cnt > SHMEM_PAGES_MAX)
+		return NULL;
+	struct shmem *shm = shmem_create (page_cnt);
+	if (shm == NULL)
+		return NULL;
+
+	/* Pages are created on first access, see vma_alloc_page(). */
+	rwlock_acquire_write (&spt->lock);
+	struct vma *vma = vma_create (&spt->vmas, addr, length, NULL, 0, 0,
+			writable, VMA_MMAP | VMA_SHARED);
+	if (vma != NULL)
+		vma->shm = shm;
+	rwlock_release_write (&spt->lock);
+	if (vma == NULL) {
+		shmem_put (shm);
+		return NULL;
+	}
+	return addr;
+}
+
+/* Takes a reference to SHM, which may be NULL, and returns it. */
+struct shmem *
+shmem_get (struct shmem *shm) {
+	if (shm != NULL)
+		__atomic_add_fetch (&shm->ref_cnt, 1, __ATOMIC_RELAXED);
+	return shm;
+}
+
+/* Drops a reference to SHM, which may be NULL, and frees it with its
+ * frames and swap slots once none is left. No page maps it by then. */
+void
+shmem_put (struct shmem *shm) {
+	if (shm == NULL
+			|| __atomic_sub_fetch (&shm->ref_cnt, 1, __ATOMIC_ACQ_REL) != 0)
+		return;
+
+	lock_acquire (&objects_lock);
+	list_remove (&shm->elem);
+	lock_release (&objects_lock);
+	/* Wait out a shmem_reclaim() that found SHM before it was removed. */
+	lock_acquire (&shm->lock);
+	lock_release (&shm->lock);
+
+	for (size_t i = 0; i < shm->page_cnt; i++) {
+		struct shmem_slot *slot = &shm->slots[i];
+		ASSERT (list_empty (&slot->mappers));
+		if (slot->frame.kva != NULL)
+			palloc_free_page (slot->frame.kva);
+		else if (slot->swap_slot_idx != INVALID_SLOT_IDX)
+			anon_swap_discard (slot->swap_slot_idx);
+	}
+	free (shm);
+}
+
+/* Creates the page of the current process at VA, which maps page IDX of
+ * SHM once it is claimed. */
+bool
+shmem_alloc_page (struct shmem *shm, void *va, size_t idx, bool writable) {
+	ASSERT (idx < shm->page_cnt);
+
+	struct page *page = calloc (1, sizeof *page);
+	if (page == NULL)
+		return false;
+	page->operations = &shmem_ops;
+	page->va = va;
+	page->writable = writable;
+	page->shmem.obj = shm;
+	page->shmem.idx = idx;
+	page->shmem.owner = thread_current ();
+	if (!spt_insert_page (&thread_current ()->spt, page)) {
+		free (page);
+		return false;
+	}
+	return true;
+}
+
+/* Returns true if PAGE is a page of shared memory. */
+bool
+shmem_is_page (struct page *page) {
+	return page->operations == &shmem_ops;
+}
+
+/* Maps PAGE, a locked page of shared memory, to the frame of its page of
+ * the object. If that is not resident, it is brought into *KVA, a free
+ * user page, and *KVA is set to NULL; if *KVA is NULL, returns false so
+ * that the caller can try again with one. */
+bool
+shmem_map_page (struct page *page, void **kva) {
+	struct shmem_page *sp = &page->shmem;
+	struct shmem_slot *slot = &sp->obj->slots[sp->idx];
+	bool success = false;
+
+	lock_acquire (&sp->obj->lock);
+	if (slot->frame.kva == NULL) {
+		if (*kva == NULL)
+			goto done;
+		slot->frame.kva = *kva;
+		*kva = NULL;
+		if (slot->swap_slot_idx != INVALID_SLOT_IDX) {
+			anon_swap_read (slot->swap_slot_idx, slot->frame.kva);
+			slot->swap_slot_idx = INVALID_SLOT_IDX;
+			thread_current ()->rusage.swapin++;
+			thread_current ()->rusage.inblock++;
+		} else
+			memset (slot->frame.kva, 0, PGSIZE);
+	}
+	if (pml4_set_page (sp->owner->pml4, page->va, slot->frame.kva,
+				page->writable)) {
+		page->frame = &slot->frame;
+		list_push_back (&slot->mappers, &sp->elem);
+		success = true;
+	}
+
+done:
+	lock_release (&sp->obj->lock);
+	return success;
+}
+
+/* Returns the page that list element E of a mapper list belongs to. */
+static struct page *
+mapper_page (struct list_elem *e) {
+	struct shmem_page *sp = list_entry (e, struct shmem_page, elem);
+	return (struct page *) ((uint8_t *) sp - offsetof (struct page, shmem));
+}
+
+/* Returns true if a mapper of SLOT accessed it since the last sweep, and
+ * clears the accessed bits for the next one. */
+static bool
+slot_accessed (struct shmem_slot *slot) {
+	bool accessed = false;
+
+	for (struct list_elem *e = list_begin (&slot->mappers);
+			e != list_end (&slot->mappers); e = list_next (e)) {
+		struct page *page = mapper_page (e);
+		uint64_t *pml4 = page->shmem.owner->pml4;
+		if (pml4_is_accessed (pml4, page->va)) {
+			pml4_set_accessed (pml4, page->va, false);
+			accessed = true;
+		}
+	}
+	return accessed;
+}
+
+/* Locks every page mapping SLOT, see vm_lock_page(), or none of them if
+ * one is locked already. */
+static bool
+slot_try_lock (struct shmem_slot *slot) {
+	struct list_elem *e;
+
+	for (e = list_begin (&slot->mappers); e != list_end (&slot->mappers);
+			e = list_next (e))
+		if (!vm_try_lock_page (mapper_page (e)))
+			break;
+	if (e == list_end (&slot->mappers))
+		return true;
+	for (struct list_elem *f = list_begin (&slot->mappers); f != e;
+			f = list_next (f))
+		vm_unlock_page (mapper_page (f));
+	return false;
+}
+
+/* Unlocks every page mapping SLOT. */
+static void
+slot_unlock (struct shmem_slot *slot) {
+	for (struct list_elem *e = list_begin (&slot->mappers);
+			e != list_end (&slot->mappers); e = list_next (e))
+		vm_unlock_page (mapper_page (e));
+}
+
+/* Advances the hand of SHM over its slots, for one turn at most, and
+ * returns the first resident slot that was not accessed since the last
+ * sweep and that no mapper has pinned, with its mappers locked. Pins are
+ * checked once the mappers are locked, since they are taken with the
+ * page locked. Returns NULL if there is none. */
+static struct shmem_slot *
+shmem_pick (struct shmem *shm) {
+	for (size_t i = 0; i < shm->page_cnt; i++) {
+		struct shmem_slot *slot = &shm->slots[shm->hand];
+		shm->hand = (shm->hand + 1) % shm->page_cnt;
+		if (slot->frame.kva == NULL || vm_frame_pinned (&slot->frame)
+				|| slot_accessed (slot) || !slot_try_lock (slot))
+			continue;
+		if (!vm_frame_pinned (&slot->frame))
+			return slot;
+		slot_unlock (slot);
+	}
+	return NULL;
+}
+
+/* Evicts a page of shared memory that none of its mappers has used since
+ * the last sweep: unmaps it everywhere, writes it to swap and returns
+ * its user page for reuse. Returns NULL if no page qualifies. Objects
+ * and pages that are locked already are passed over. */
+void *
+shmem_reclaim (void) {
+	struct shmem *victim = NULL;
+	struct shmem_slot *slot = NULL;
+
+	lock_acquire (&objects_lock);
+	for (size_t n = list_size (&objects); n > 0 && victim == NULL; n--) {
+		struct shmem *shm = list_entry (list_pop_front (&objects),
+				struct shmem, elem);
+		list_push_back (&objects, &shm->elem);
+		if (!lock_try_acquire (&shm->lock))
+			continue;
+		slot = shmem_pick (shm);
+		if (slot != NULL)
+			victim = shm;
+		else
+			lock_release (&shm->lock);
+	}
+	lock_release (&objects_lock);
+	if (victim == NULL)
+		return NULL;
+
+	/* Unmap first, so that a store during the write faults and waits for
+	 * the page instead of being lost. */
+	while (!list_empty (&slot->mappers)) {
+		struct page *page = mapper_page (list_pop_front (&slot->mappers));
+		pml4_clear_page (page->shmem.owner->pml4, page->va);
+		page->frame = NULL;
+		vm_unlock_page (page);
+	}
+	slot->swap_slot_idx = anon_swap_write (slot->frame.kva);
+
+	void *kva = slot->frame.kva;
+	slot->frame.kva = NULL;
+	lock_release (&victim->lock);
+	return kva;
+}
+
+static bool
+shmem_swap_in (struct page *page UNUSED, void *kva UNUSED) {
+	return false;
+}
+
+static bool
+shmem_swap_out (struct page *page UNUSED) {
+	return false;
+}
+
+/* Unmaps PAGE so that pml4_destroy() leaves the shared frame alone. The
+ * object outlives PAGE, since PAGE's area holds a reference to it. PAGE
+ * will be freed by the caller. */
+static void
+shmem_destroy (struct page *page) {
+	struct shmem *shm = page->shmem.obj;
+
+	lock_acquire (&shm->lock);
+	if (page->frame != NULL) {
+		pml4_clear_page (page->shmem.owner->pml4, page->va);
+		list_remove (&page->shmem.elem);
+		page->frame = NULL;
+	}
+	lock_release (&shm->lock);
+}
@@ -11,6 +11,7 @@
 #include "vm/vm.h"
 #include "vm/uninit.h"
 #include "threads/malloc.h"
+#include "userprog/process.h"
 
 static bool uninit_initialize (struct page *page, void *kva);
 static void uninit_destroy (struct page *page);
@@ -66,6 +67,8 @@ uninit_destroy (struct page *page) {
 	// struct uninit_page *uninit UNUSED = &page->uninit;
 	/* TODO: Fill this function.
 	 * TODO: If you don't have anything to do, just return. */
-	if (page->uninit.aux != NULL) free (page->uninit.aux);
+	/* ELF segment pages point at their area, which is not theirs. */
+	if (page->uninit.aux != NULL && page->uninit.init != lazy_load_segment)
+		free (page->uninit.aux);
 	return;
 }
@@ -5,17 +5,40 @@
 #include "vm/inspect.h"
 
 #include "lib/kernel/hash.h"
+#include <round.h>
+#include <stdio.h>
+#include <string.h>
 
 // 추가
+#include "threads/mmu.h"
 #include "threads/vaddr.h"
 #include "vm/file.h"
+#include "vm/fcache.h"
+#include "vm/shmem.h"
 #include "userprog/process.h"
+#include "intrinsic.h"
 
 struct list frame_list;
 static struct list_elem *clock_elem;
 static struct lock clock_lock;
 
-static struct lock spt_kill_lock;
+bool vm_print_rusage;
+
+/* Guards the busy flag of every page. Threads waiting for a busy page
+ * wait on PAGE_UNBUSY; the lock is never held across I/O. */
+static struct lock page_lock;
+static struct condition page_unbusy;
+
+/* kswapd starts reclaiming when fewer than FREE_LOW user pages are free
+ * and stops once FREE_HIGH are. */
+static size_t free_low, free_high;
+static struct semaphore kswapd_wake;
+static bool kswapd_running;         /* Woken and not done yet. */
+static void kswapd (void *aux);
+
+/* Bounds of the fault-around window, in pages. */
+#define FAULT_AROUND_MIN 2
+#define FAULT_AROUND_MAX 16
 
 // -------------- 끝!
 
@@ -31,10 +54,18 @@ vm_init (void) {
 	register_inspect_intr ();
 	/* DO NOT MODIFY UPPER LINES. */
 	/* TODO: Your code goes here. */
-	lock_init(&spt_kill_lock);
+	fcache_init ();
+	shmem_init ();
 	list_init(&frame_list);
 	clock_elem = NULL;
 	lock_init (&clock_lock);
+	lock_init (&page_lock);
+	cond_init (&page_unbusy);
+
+	free_low = MAX (palloc_pool_size (PAL_USER) / 64, 4);
+	free_high = free_low * 2;
+	sema_init (&kswapd_wake, 0);
+	thread_create ("kswapd", PRI_DEFAULT, kswapd, NULL);
 }
 
 /* Get the type of the page. This function is useful if you want to know the
@@ -52,9 +83,21 @@ page_get_type (struct page *page) {
 }
 
 /* Helpers */
-static struct frame *vm_get_victim (void);
+static struct frame *vm_get_victim (struct thread *owner, bool protect);
 static bool vm_do_claim_page (struct page *page);
-static struct frame *vm_evict_frame (void);
+static bool vm_handle_fault (struct intr_frame *f, void *addr, bool user,
+		bool write, bool not_present);
+static bool vm_map_frame (struct page *page, struct frame *frame);
+static bool vm_claim_shared (struct page *page, bool evict);
+static bool vm_claim_shmem (struct page *page);
+static struct frame *vm_evict_frame (struct thread *owner);
+static void vm_fault_around (struct supplemental_page_table *spt,
+		struct page *page, struct inode *inode, bool segment);
+static void vm_drop_behind (struct vma *vma, void *va);
+static bool vm_do_madvise (struct supplemental_page_table *spt,
+		void *start, void *end, int advice);
+static struct inode *page_backing_inode (struct page *page);
+static bool page_is_shareable (struct page *page);
 void spt_destructor(struct hash_elem *e, void* aux);
 
 
@@ -90,6 +133,14 @@ vm_alloc_page_with_initializer (enum vm_type type, void *upage, bool writable,
 	return false;
 }
 
+/* Initializer of demand-zero anonymous pages. Frames come with whatever
+ * the pool or the last user left in them, so the page is cleared. */
+bool
+vm_zero_page (struct page *page, void *aux UNUSED) {
+	memset (page->frame->kva, 0, PGSIZE);
+	return true;
+}
+
 /* Find VA from spt and return page. On error, return NULL. */
 // spt테이블에서 내가 원하는 테이블을 찾는 함수
 struct page *
@@ -103,6 +154,44 @@ spt_find_page (struct supplemental_page_table *spt UNUSED, void *va UNUSED) {
 	return result;
 }
 
+/* Like spt_find_page(), but if VA lies in an area of SPT and its page
+ * has not been used yet, creates the page first. */
+struct page *
+spt_get_page (struct supplemental_page_table *spt, void *va) {
+	struct page *page = spt_find_page (spt, va);
+	if (page == NULL) {
+		struct vma *vma = vma_find (&spt->vmas, va);
+		if (vma != NULL && vma_alloc_page (vma, pg_round_down (va)))
+			page = spt_find_page (spt, va);
+	}
+	return page;
+}
+
+/* Returns true if no page in [START, END) is in SPT or covered by one of
+ * its areas. Walks whichever of the range and the table is smaller. */
+bool
+spt_range_free (struct supplemental_page_table *spt, void *start,
+		void *end) {
+	if (vma_overlaps (&spt->vmas, start, end))
+		return false;
+
+	if ((size_t) (end - start) / PGSIZE <= hash_size (spt->pages)) {
+		for (void *va = start; va < end; va += PGSIZE)
+			if (spt_find_page (spt, va) != NULL)
+				return false;
+		return true;
+	}
+
+	struct hash_iterator i;
+	hash_first (&i, spt->pages);
+	while (hash_next (&i)) {
+		struct page *page = hash_entry (hash_cur (&i), struct page, hash_elem);
+		if (page->va >= start && page->va < end)
+			return false;
+	}
+	return true;
+}
+
 /* Insert PAGE into spt with validation. */
 bool
 spt_insert_page (struct supplemental_page_table *spt,
@@ -115,7 +204,10 @@ spt_insert_page (struct supplemental_page_table *spt,
 void
 spt_remove_page (struct supplemental_page_table *spt, struct page *page) {
 	struct hash_elem* e = hash_delete (spt -> pages, &page ->hash_elem);
-	if (e != NULL) vm_dealloc_page (page);
+	if (e != NULL) {
+		vm_lock_page (page);
+		vm_dealloc_page (page);
+	}
 	return;
 }
 
@@ -130,46 +222,248 @@ list_next_cycle (struct list *lst, struct list_elem *elem) {
       return cand_elem;
 }
 
-/* Get the struct frame, that will be evicted. */
+/* Returns the frame of clock list element E, which is on the global
+ * clock if LOCAL is false and on its owner's clock otherwise. */
 static struct frame *
-vm_get_victim (void) {
+clock_frame (struct list_elem *e, bool local) {
+	return local ? list_entry (e, struct frame, owner_elem)
+		: list_entry (e, struct frame, frame_elem);
+}
+
+/* Removes E from clock LIST, moving *HAND on if it points at E. */
+static void
+clock_unlink (struct list *list, struct list_elem **hand,
+		struct list_elem *e) {
+	if (*hand == e) {
+		*hand = list_next_cycle (list, e);
+		if (*hand == e)
+			*hand = NULL;
+	}
+	list_remove (e);
+}
+
+/* Takes FRAME off both clocks. CLOCK_LOCK must be held. */
+static void
+clock_remove (struct frame *frame) {
+	struct thread *owner = frame->owner;
+
+	clock_unlink (&frame_list, &clock_elem, &frame->frame_elem);
+	clock_unlink (&owner->frames, &owner->clock_hand, &frame->owner_elem);
+	owner->frame_cnt--;
+}
+
+/* Locks PAGE, waiting while another thread has it locked. A locked page
+ * is not evicted, written back or freed by anyone else, so the lock is
+ * held while a page is brought in or taken out of memory. */
+void
+vm_lock_page (struct page *page) {
+	lock_acquire (&page_lock);
+	while (page->busy)
+		cond_wait (&page_unbusy, &page_lock);
+	page->busy = true;
+	lock_release (&page_lock);
+}
+
+/* Locks PAGE if no one has it locked. Returns true if successful. */
+bool
+vm_try_lock_page (struct page *page) {
+	bool success;
+
+	lock_acquire (&page_lock);
+	success = !page->busy;
+	page->busy = true;
+	lock_release (&page_lock);
+	return success;
+}
+
+/* Unlocks PAGE and wakes up threads waiting for it. */
+void
+vm_unlock_page (struct page *page) {
+	lock_acquire (&page_lock);
+	ASSERT (page->busy);
+	page->busy = false;
+	cond_broadcast (&page_unbusy, &page_lock);
+	lock_release (&page_lock);
+}
+
+/* Undoes frame_try_lock() for PAGE of OWNER. */
+static void
+frame_unlock (struct thread *owner, struct page *page) {
+	vm_unlock_page (page);
+	if (owner != thread_current ())
+		rwlock_release_read (&owner->spt.lock);
+}
+
+/* Locks the page of FRAME for eviction and, if it belongs to another
+ * process, that process's address space against changes. Never waits
+ * for either: a process in the middle of munmap() or exit is passed
+ * over. */
+static bool
+frame_try_lock (struct frame *frame) {
+	struct thread *owner = frame->owner;
+	bool foreign = owner != thread_current ();
+
+	if (foreign && !rwlock_try_acquire_read (&owner->spt.lock))
+		return false;
+	if (!vm_try_lock_page (frame->page)) {
+		if (foreign)
+			rwlock_release_read (&owner->spt.lock);
+		return false;
+	}
+	/* Pinning happens with the page locked. */
+	if (vm_frame_pinned (frame)) {
+		frame_unlock (owner, frame->page);
+		return false;
+	}
+	return true;
+}
+
+/* Get the struct frame, that will be evicted. With OWNER, only its
+ * frames are considered, on its own clock. Otherwise the global clock
+ * runs, and if PROTECT is true it passes over frames of processes that
+ * are within their guaranteed resident set. The victim is returned
+ * locked by frame_try_lock(); frames that cannot be locked right away
+ * are passed over. */
+static struct frame *
+vm_get_victim (struct thread *owner, bool protect) {
 	/* Simple Clock Algorithm with Vairable Space? */
 	struct frame *candidate = NULL;
-	struct thread *curr = thread_current ();
+	bool local = owner != NULL;
+	struct list *list = local ? &owner->frames : &frame_list;
+	struct list_elem **hand = local ? &owner->clock_hand : &clock_elem;
 
 	// This need careful synchronization, race between threads.
 	lock_acquire (&clock_lock);
-	struct list_elem *cand_elem = clock_elem;
-	if (cand_elem == NULL && !list_empty (&frame_list))
-	      cand_elem = list_front (&frame_list);
+	if (list_empty (list)) {
+	      lock_release (&clock_lock);
+	      return NULL;
+	}
+	struct list_elem *cand_elem = *hand;
+	if (cand_elem == NULL)
+	      cand_elem = list_front (list);
+	// Two sweeps find a victim, unless every frame is passed over.
+	size_t budget = 2 * list_size (list) + 1;
 	while (cand_elem != NULL) {
-	      // Check frame accessed
-	      candidate = list_entry (cand_elem, struct frame, frame_elem);
-	      if (!pml4_is_accessed (curr->pml4, candidate->page->va))//참조비트가 1인걸 못찾은거==0인걸 찾은것
-		    break; // Found!
-	      pml4_set_accessed (curr->pml4, candidate->page->va, false);//참조비트 1->0으로 바꿔줌
-
-	      cand_elem = list_next_cycle (&frame_list, cand_elem);	}//포인터 넘기고
-	// Candidate in frame_list at clock_elem will be evicted.
+	      if (budget-- == 0) {
+		    lock_release (&clock_lock);
+		    return NULL;
+	      }
+	      candidate = clock_frame (cand_elem, local);
+	      if (vm_frame_pinned (candidate) || (protect
+			  && candidate->owner->frame_cnt <= candidate->owner->rss_min)) {
+		    cand_elem = list_next_cycle (list, cand_elem);
+		    continue;
+	      }
+	      // Check frame accessed, in the page table of the frame's owner
+	      uint64_t *pml4 = candidate->owner->pml4;
+	      if (!pml4_is_accessed (pml4, candidate->page->va)) {//참조비트가 1인걸 못찾은거==0인걸 찾은것
+		    if (frame_try_lock (candidate))
+			  break; // Found!
+	      }
+	      else
+		    pml4_set_accessed (pml4, candidate->page->va, false);//참조비트 1->0으로 바꿔줌
+
+	      cand_elem = list_next_cycle (list, cand_elem);	}//포인터 넘기고
+	// Candidate at the hand will be evicted.
 	// Tick clock.
-	clock_elem = list_next_cycle (&frame_list, cand_elem);//포인터 옮기는거인가봐
-	list_remove (cand_elem); // 그 위치를 지우고
+	*hand = list_next_cycle (list, cand_elem);//포인터 옮기는거인가봐
+	clock_remove (candidate); // 그 위치를 지우고
 	lock_release (&clock_lock);
 
 	return candidate; // 그위치에 넣어주라고 리턴함
 }
 
-/* Evict one page and return the corresponding frame.
+/* Takes FRAME off the eviction clocks and frees it. The user page it
+ * holds is left to the caller. */
+void
+vm_remove_frame (struct frame *frame) {
+	lock_acquire (&clock_lock);
+	clock_remove (frame);
+	lock_release (&clock_lock);
+	free (frame);
+}
+
+/* Brings PAGE of the current process into memory and keeps it there
+ * until vm_unpin_page(), so that the kernel can access it without
+ * faulting while holding locks. Returns false if PAGE could not be
+ * brought in. */
+bool
+vm_pin_page (struct page *page) {
+	uint64_t *pml4 = thread_current ()->pml4;
+
+	for (;;) {
+		/* A present page cannot be in the middle of eviction here. */
+		vm_lock_page (page);
+		if (pml4_get_page (pml4, page->va) != NULL) {
+			__atomic_add_fetch (&page->frame->pin_cnt, 1, __ATOMIC_ACQ_REL);
+			vm_unlock_page (page);
+			return true;
+		}
+		vm_unlock_page (page);
+		if (!vm_do_claim_page (page))
+			return false;
+	}
+}
+
+/* Drops a pin vm_pin_page() took on PAGE. The frame can be evicted
+ * again once every pin on it is gone, which for a shared frame may be
+ * another process's. */
+void
+vm_unpin_page (struct page *page) {
+	ASSERT (page->frame != NULL);
+	int cnt = __atomic_sub_fetch (&page->frame->pin_cnt, 1, __ATOMIC_ACQ_REL);
+	ASSERT (cnt >= 0);
+}
+
+/* Returns true if FRAME is pinned. Pins are taken with the page locked,
+ * so the answer holds while the caller has the page, or every page
+ * mapping a shared frame, locked. */
+bool
+vm_frame_pinned (struct frame *frame) {
+	return __atomic_load_n (&frame->pin_cnt, __ATOMIC_ACQUIRE) != 0;
+}
+
+/* Stores up to MAX frames on the eviction clock for which PRED returns
+ * true into FRAMES and returns how many were found. PRED runs with the
+ * clock locked and must not sleep. The pages of the frames returned are
+ * locked, see vm_lock_page(), and frames whose page is locked already
+ * are passed over. */
+size_t
+vm_scan_frames (bool (*pred) (struct frame *), struct frame **frames,
+		size_t max) {
+	size_t cnt = 0;
+
+	lock_acquire (&clock_lock);
+	for (struct list_elem *e = list_begin (&frame_list);
+			e != list_end (&frame_list) && cnt < max; e = list_next (e)) {
+		struct frame *frame = list_entry (e, struct frame, frame_elem);
+		if (pred (frame) && vm_try_lock_page (frame->page))
+			frames[cnt++] = frame;
+	}
+	lock_release (&clock_lock);
+	return cnt;
+}
+
+/* Evict one page and return the corresponding frame. With OWNER, the
+ * page is one of OWNER's; the guarantee of a resident set only holds
+ * against other processes, so it does not apply. Otherwise guaranteed
+ * resident sets are only broken into if nothing else can go.
  * Return NULL on error.*/
 static struct frame *
-vm_evict_frame (void) {
-	struct frame *victim = vm_get_victim ();
-	if (victim == NULL) return NULL;
+vm_evict_frame (struct thread *owner) {
+	struct frame *victim = vm_get_victim (owner, owner == NULL);
+	if (victim == NULL && owner == NULL)
+		victim = vm_get_victim (NULL, false);
+	if (victim == NULL)
+		return NULL;
 
-	/* Swap out the victim and return the evicted frame. */
+	/* Swap out the victim and return the evicted frame. Only the page
+	 * is locked during the write, so other faults go on meanwhile. */
 	struct page *page = victim->page;
+	struct thread *victim_owner = victim->owner;
 	bool swap_done = swap_out (page);
 	if (!swap_done) PANIC("Swap is full!\n");
+	frame_unlock (victim_owner, page);
 
 	// Clear frame
 	victim->page = NULL;
@@ -178,6 +472,42 @@ vm_evict_frame (void) {
 	return victim;
 }
 
+/* Wraps KVA, a user page, in a new frame. Returns NULL and frees KVA if
+ * out of memory or if KVA is NULL. */
+static struct frame *
+vm_new_frame (void *kva) {
+	if (kva == NULL)
+		return NULL;
+
+	struct frame *frame = malloc (sizeof (struct frame));
+	if (frame == NULL) {
+		palloc_free_page (kva);
+		return NULL;
+	}
+	frame->kva = kva;
+	frame->page = NULL;
+	frame->owner = NULL;
+	frame->pin_cnt = 0;
+	return frame;
+}
+
+/* Wraps KVA, a user page just reclaimed from the frame cache or from
+ * shared memory, in a new frame. The page is cleared first, like an
+ * evicted one, since it still holds data of other processes. */
+static struct frame *
+vm_reclaimed_frame (void *kva) {
+	if (kva != NULL)
+		memset (kva, 0, PGSIZE);
+	return vm_new_frame (kva);
+}
+
+/* Returns a frame backed by a free user page, or NULL if the user pool
+ * is exhausted. Never evicts. */
+static struct frame *
+vm_try_get_frame (void) {
+	return vm_new_frame (palloc_get_page (PAL_USER));
+}
+
 /* palloc() and get frame. If there is no available page, evict the page
  * and return it. This always return valid address. That is, if the user pool
  * memory is full, this function evicts the frame to get the available memory
@@ -187,32 +517,161 @@ vm_evict_frame (void) {
 static struct frame *
 vm_get_frame(void)
 {
-	struct frame * frame = malloc (sizeof (struct frame));
-	frame -> kva = palloc_get_page (PAL_USER);
-	frame -> page = NULL;
-	// Add swap case handling
-	if (frame->kva == NULL) {
-	  free (frame);
-	  frame = vm_evict_frame ();
+	struct thread *curr = thread_current ();
+	struct frame *frame;
+
+	/* A process at its resident limit replaces one of its own pages. */
+	if (curr->rss_limit != 0 && curr->frame_cnt >= curr->rss_limit) {
+	  frame = vm_evict_frame (curr);
+	  if (frame != NULL)
+	    return frame;
 	}
-	ASSERT (frame->kva != NULL);
+
+	// Add swap case handling
+	frame = vm_try_get_frame ();
+	/* Only the thread that flips the flag wakes kswapd. */
+	if (palloc_free_cnt (PAL_USER) < free_low
+	    && !__atomic_exchange_n (&kswapd_running, true, __ATOMIC_ACQ_REL))
+	  sema_up (&kswapd_wake);
+	/* kswapd is behind: reclaim directly. */
+	if (frame == NULL)
+	  /* Cached text is clean, so it is cheaper to drop than other pages. */
+	  frame = vm_reclaimed_frame (fcache_reclaim ());
+	if (frame == NULL)
+	  frame = vm_reclaimed_frame (shmem_reclaim ());
+	if (frame == NULL)
+	  frame = vm_evict_frame (NULL);
+	ASSERT (frame != NULL && frame->kva != NULL);
 	return frame;
 }
 
-/* Growing the stack. */
+/* Reclaims user pages in the background whenever free ones run short,
+ * so that faults seldom have to evict a page themselves. Drops cached
+ * text first, then evicts, but only while swap has room to spare;
+ * the last slots are left to direct reclaim. */
 static void
-vm_stack_growth (void *addr UNUSED) {
-	void *stack_bottom = pg_round_down (addr);
-	size_t req_stack_size = USER_STACK - (uintptr_t)stack_bottom;
-	if (req_stack_size > (1 << 20)) PANIC("Stack limit exceeded!\n"); // 1MB
+kswapd (void *aux UNUSED) {
+	for (;;) {
+		sema_down (&kswapd_wake);
+		bool swap_ok = anon_swap_free_cnt () > free_high;
+
+		while (palloc_free_cnt (PAL_USER) < free_high) {
+			void *kva = fcache_reclaim ();
+			if (kva == NULL && swap_ok)
+				kva = shmem_reclaim ();
+			if (kva == NULL && swap_ok) {
+				struct frame *frame = vm_evict_frame (NULL);
+				if (frame != NULL) {
+					kva = frame->kva;
+					free (frame);
+				}
+			}
+			if (kva == NULL)
+				break;
+			palloc_free_page (kva);
+		}
+		__atomic_store_n (&kswapd_running, false, __ATOMIC_RELEASE);
+	}
+}
+
+/* Growing the stack. Only the page holding ADDR is added, and it is
+ * brought in like any other page when it is claimed, zeroed since the
+ * frame may come from another process. */
+static bool
+vm_stack_growth (void *addr) {
+	if (!vm_alloc_page_with_initializer (VM_ANON | VM_MARKER_0,
+				pg_round_down (addr), true, vm_zero_page, NULL))
+		return false;
+	thread_current ()->rusage.stackflt++;
+	return true;
+}
+
+/* Returns true if ADDR is a place the stack of the current process may
+ * grow to, given the user stack pointer RSP: within the stack limit and
+ * no lower than a push could write. */
+static bool
+vm_is_stack_access (void *addr, uintptr_t rsp) {
+	uintptr_t va = (uintptr_t) addr;
+	return va < USER_STACK
+		&& va >= USER_STACK - thread_current ()->stack_limit
+		&& va >= rsp - 8;
+}
+
+/* Returns true if [START, END) intersects the part of the address space
+ * reserved for the stack of the current process and its guard. */
+bool
+vm_stack_reserved (void *start, void *end) {
+	uintptr_t bottom = USER_STACK - thread_current ()->stack_limit
+		- STACK_GUARD;
+	return (uintptr_t) end > bottom && (uintptr_t) start < USER_STACK;
+}
+
+/* Sets the stack limit of the current process to LIMIT bytes, rounded up
+ * to whole pages. Fails if LIMIT is out of range or would reserve space
+ * that is already mapped. */
+bool
+vm_set_stack_limit (size_t limit) {
+	struct thread *curr = thread_current ();
 
-	// Alloc page from tested region to previous claimed stack page.
-	void *growing_stack_bottom = stack_bottom;
-	while ((uintptr_t) growing_stack_bottom < USER_STACK &&
-		vm_alloc_page (VM_ANON | VM_MARKER_0, growing_stack_bottom, true)) {
-	      growing_stack_bottom += PGSIZE;
-	};
-	vm_claim_page (stack_bottom);
+	limit = ROUND_UP (limit, PGSIZE);
+	if (limit < PGSIZE || limit > STACK_LIMIT_MAX)
+		return false;
+	void *bottom = (void *) (USER_STACK - limit - STACK_GUARD);
+	if (vma_overlaps (&curr->spt.vmas, bottom, (void *) USER_STACK))
+		return false;
+	curr->stack_limit = limit;
+	return true;
+}
+
+/* Limits the current process to LIMIT bytes of resident memory, rounded
+ * up to whole pages, or lifts the limit if LIMIT is 0. Pages over the
+ * new limit are evicted right away. Fails if LIMIT is too small to make
+ * progress or below the process's guarantee. */
+bool
+vm_set_rss_limit (size_t limit) {
+	struct thread *curr = thread_current ();
+	size_t pages = DIV_ROUND_UP (limit, PGSIZE);
+
+	if (pages != 0 && (pages < RSS_LIMIT_MIN || pages < curr->rss_min))
+		return false;
+	curr->rss_limit = pages;
+	while (pages != 0 && curr->frame_cnt > pages) {
+		struct frame *frame = vm_evict_frame (curr);
+		if (frame == NULL)
+			break;
+		palloc_free_page (frame->kva);
+		free (frame);
+	}
+	return true;
+}
+
+/* Guarantees the current process MIN bytes of resident memory, rounded
+ * up to whole pages: other processes evict its pages only when nothing
+ * else is left. At most half of user memory can be guaranteed, and not
+ * more than the process's own limit. */
+bool
+vm_set_rss_min (size_t min) {
+	struct thread *curr = thread_current ();
+	size_t pages = DIV_ROUND_UP (min, PGSIZE);
+
+	if (pages > palloc_pool_size (PAL_USER) / 2
+			|| (curr->rss_limit != 0 && pages > curr->rss_limit))
+		return false;
+	curr->rss_min = pages;
+	return true;
+}
+
+/* Returns the page of the current process at VA, creating it if VA lies
+ * in an area or where the stack may grow to, given the user stack
+ * pointer RSP. Returns NULL if VA is not valid user memory. */
+struct page *
+vm_get_page (void *va, uintptr_t rsp) {
+	struct supplemental_page_table *spt = &thread_current ()->spt;
+	struct page *page = spt_get_page (spt, va);
+
+	if (page == NULL && vm_is_stack_access (va, rsp) && vm_stack_growth (va))
+		page = spt_find_page (spt, va);
+	return page;
 }
 
 /* Handle the fault on write_protected page */
@@ -227,6 +686,7 @@ vm_try_handle_fault (struct intr_frame *f UNUSED, void *addr UNUSED,
 		bool user UNUSED, bool write UNUSED, bool not_present UNUSED) {
 	struct thread *curr = thread_current ();
 	struct supplemental_page_table *spt = &curr->spt;
+	uint64_t start = rdtsc ();
 	/* TODO: Validate the fault */
 	/* TODO: Your code goes here */
 
@@ -234,19 +694,266 @@ vm_try_handle_fault (struct intr_frame *f UNUSED, void *addr UNUSED,
 		return false;
 	}
 
-	void *stack_bottom = pg_round_down (curr->saved_sp);
-	if (write && (stack_bottom - PGSIZE <= addr &&
-	      (uintptr_t) addr < USER_STACK)) {
-	  /* Allow stack growth writing below single PGSIZE range
-	   * of current stack bottom inferred from stack pointer. */
-	  vm_stack_growth (addr);
-	  return true;
-	}
+	/* Faults only read the address space, so they run alongside the
+	 * eviction of this process's pages by others. */
+	rwlock_acquire_read (&spt->lock);
+	bool success = vm_handle_fault (f, addr, user, write, not_present);
+	rwlock_release_read (&spt->lock);
+	curr->rusage.fault_cycles += rdtsc () - start;
+	return success;
+}
+
+/* Handles a fault for vm_try_handle_fault(), with the address space
+ * locked for reading. */
+static bool
+vm_handle_fault (struct intr_frame *f, void *addr, bool user, bool write,
+		bool not_present) {
+	struct thread *curr = thread_current ();
+	struct supplemental_page_table *spt = &curr->spt;
 
-	struct page* page = spt_find_page (spt, addr);
+	/* A fault in the kernel happens inside a system call, which saved
+	 * the user stack pointer on entry. */
+	uintptr_t rsp = user ? f->rsp : curr->saved_sp;
+	struct page* page = vm_get_page (addr, rsp);
 	if (page == NULL) return false;
 	if (write && !not_present) return vm_handle_wp (page);
-	return vm_do_claim_page (page);
+
+	struct inode *inode = page_backing_inode (page);
+	bool segment = fcache_is_text (page)
+		|| (page->operations->type == VM_UNINIT
+			&& page->uninit.init == lazy_load_segment);
+	bool file = page_get_type (page) == VM_FILE;
+	long inblock = curr->rusage.inblock;
+	if (!vm_do_claim_page (page))
+		return false;
+
+	/* Major if bringing the page in took a read, minor otherwise. */
+	if (curr->rusage.inblock != inblock)
+		curr->rusage.majflt++;
+	else
+		curr->rusage.minflt++;
+	if (file)
+		curr->rusage.fileflt++;
+	if (inode != NULL)
+		vm_fault_around (spt, page, inode, segment);
+	return true;
+}
+
+/* Fills USAGE with the paging statistics of the current process. */
+void
+vm_get_rusage (struct rusage *usage) {
+	struct thread *curr = thread_current ();
+	struct hash_iterator i;
+
+	*usage = curr->rusage;
+	usage->rss = 0;
+	usage->swap = 0;
+	if (curr->spt.pages == NULL)
+		return;
+	hash_first (&i, curr->spt.pages);
+	while (hash_next (&i)) {
+		struct page *page = hash_entry (hash_cur (&i), struct page, hash_elem);
+		if (page->frame != NULL)
+			usage->rss++;
+		else if (page->operations->type != VM_UNINIT
+				&& page_get_type (page) == VM_ANON && !shmem_is_page (page)
+				&& !fcache_is_text (page)
+				&& page->anon.swap_slot_idx != INVALID_SLOT_IDX)
+			usage->swap++;
+	}
+}
+
+/* Prints the paging statistics of the current process if "-vmstat" was
+ * given. Called as the process exits, before its pages are freed. */
+void
+vm_exit_rusage (void) {
+	struct rusage ru;
+
+	if (!vm_print_rusage)
+		return;
+	vm_get_rusage (&ru);
+	printf ("%s: rusage minflt=%ld majflt=%ld fileflt=%ld stackflt=%ld "
+			"swapin=%ld swapout=%ld inblock=%ld oublock=%ld cycles=%ld "
+			"rss=%ld swap=%ld\n", thread_name (), ru.minflt, ru.majflt,
+			ru.fileflt, ru.stackflt, ru.swapin, ru.swapout, ru.inblock,
+			ru.oublock, ru.fault_cycles, ru.rss, ru.swap);
+}
+
+/* Returns the inode PAGE will be read from when it is brought in, or
+ * NULL if PAGE is already present or is not backed by a file. Lazily
+ * loaded ELF segments count as file-backed here, except for pages that
+ * hold no file data at all. */
+static struct inode *
+page_backing_inode (struct page *page) {
+	if (page->frame != NULL)
+		return NULL;
+
+	if (fcache_is_text (page))
+		return file_get_inode (page->text.vma->file);
+	if (page->operations->type == VM_UNINIT) {
+		if (page->uninit.init == lazy_load_segment)
+			return file_get_inode (((struct vma *) page->uninit.aux)->file);
+		if (VM_TYPE (page->uninit.type) == VM_FILE)
+			return file_get_inode (((struct mmap_info *) page->uninit.aux)->file);
+		return NULL;
+	}
+	if (page_get_type (page) == VM_FILE && page->file.file != NULL)
+		return file_get_inode (page->file.file);
+	return NULL;
+}
+
+/* Populates pages right after PAGE that are read from the same INODE and
+ * not yet present, so that a sequential scan takes one fault per window
+ * instead of one per page. ELF SEGMENT pages are always read around.
+ * Mappings are only read around once two faults in a row have landed
+ * right after the previous window; the window then doubles on every such
+ * fault. madvise() advice of the area overrides this. Stops at the first
+ * page that does not qualify, and never evicts to make room. */
+static void
+vm_fault_around (struct supplemental_page_table *spt, struct page *page,
+		struct inode *inode, bool segment) {
+	struct vma *vma = vma_find (&spt->vmas, page->va);
+	int advice = vma != NULL ? vma->advice : MADV_NORMAL;
+
+	if (advice == MADV_RANDOM)
+		return;
+	if (page->va == spt->fa_next)
+		spt->fa_streak++;
+	else {
+		spt->fa_streak = 0;
+		spt->fa_window = 0;
+	}
+	if (spt->fa_streak >= 2)
+		spt->fa_window = spt->fa_window == 0 ? FAULT_AROUND_MIN
+			: MIN (spt->fa_window * 2, FAULT_AROUND_MAX);
+
+	size_t window = spt->fa_window;
+	if (segment && window < FAULT_AROUND_MIN)
+		window = FAULT_AROUND_MIN;
+	if (advice == MADV_SEQUENTIAL) {
+		window = FAULT_AROUND_MAX;
+		vm_drop_behind (vma, page->va);
+	}
+
+	void *va = page->va + PGSIZE;
+	for (size_t i = 0; i < window; i++, va += PGSIZE) {
+		struct page *next = spt_get_page (spt, va);
+		if (next == NULL || !vm_try_lock_page (next))
+			break;
+
+		bool success = false;
+		if (page_backing_inode (next) != inode)
+			;
+		else if (page_is_shareable (next))
+			success = vm_claim_shared (next, false);
+		else {
+			struct frame *frame = vm_try_get_frame ();
+			success = frame != NULL && vm_map_frame (next, frame);
+		}
+		vm_unlock_page (next);
+		if (!success)
+			break;
+	}
+	spt->fa_next = va;
+}
+
+/* Marks the pages of VMA that a sequential reader now at VA has left well
+ * behind as not recently used, so that the clock evicts them first. */
+static void
+vm_drop_behind (struct vma *vma, void *va) {
+	struct thread *curr = thread_current ();
+	size_t behind = (va - vma->start) / PGSIZE;
+
+	if (behind <= FAULT_AROUND_MAX)
+		return;
+	void *end = va - FAULT_AROUND_MAX * PGSIZE;
+	void *start = va - MIN (behind, 2 * FAULT_AROUND_MAX) * PGSIZE;
+	for (void *p = start; p < end; p += PGSIZE) {
+		struct page *page = spt_find_page (&curr->spt, p);
+		if (page != NULL && page->frame != NULL)
+			pml4_set_accessed (curr->pml4, p, false);
+	}
+}
+
+/* Queues the not yet present file pages of [START, END) in VMA for
+ * read-ahead into the frame cache. */
+static void
+vm_willneed (struct supplemental_page_table *spt, struct vma *vma,
+		void *start, void *end) {
+	struct inode *inode = file_get_inode (vma->file);
+
+	for (void *va = start; va < end; va += PGSIZE) {
+		struct page *page = spt_find_page (spt, va);
+		size_t read_bytes = vma_page_read_bytes (vma, va);
+		if ((page == NULL || page->frame == NULL) && read_bytes > 0)
+			fcache_prefetch (inode, vma_page_offset (vma, va), read_bytes);
+	}
+}
+
+/* Discards the contents of the pages in [START, END). Pages of an area
+ * are dropped, after writing back mmap'd data, and are loaded from the
+ * file again when next used. Other anonymous pages read back as zeros. */
+static void
+vm_dontneed (struct supplemental_page_table *spt, void *start, void *end) {
+	for (void *va = start; va < end; va += PGSIZE) {
+		struct page *page = spt_find_page (spt, va);
+		if (page == NULL)
+			continue;
+		if (vma_find (&spt->vmas, va) != NULL) {
+			spt_remove_page (spt, page);
+			continue;
+		}
+		if (page->operations->type == VM_UNINIT || page_get_type (page) != VM_ANON)
+			continue;
+
+		/* Stack pages carry VM_MARKER_0 in their operations, see
+		 * anon_initializer(), so the new page is a stack page again. */
+		enum vm_type type = page->operations->type;
+		bool writable = page->writable;
+		spt_remove_page (spt, page);
+		vm_alloc_page_with_initializer (type, va, writable, vm_zero_page, NULL);
+	}
+}
+
+/* Applies madvise() ADVICE to [START, END) of the current process.
+ * Access pattern advice is kept per area and covers whole areas. */
+bool
+vm_madvise (void *start, void *end, int advice) {
+	struct supplemental_page_table *spt = &thread_current ()->spt;
+	bool success;
+
+	rwlock_acquire_write (&spt->lock);
+	success = vm_do_madvise (spt, start, end, advice);
+	rwlock_release_write (&spt->lock);
+	return success;
+}
+
+/* Applies ADVICE for vm_madvise(), with SPT locked for writing. */
+static bool
+vm_do_madvise (struct supplemental_page_table *spt, void *start, void *end,
+		int advice) {
+	switch (advice) {
+		case MADV_NORMAL:
+		case MADV_RANDOM:
+		case MADV_SEQUENTIAL:
+			for (struct vma *vma = vma_next (&spt->vmas, start);
+					vma != NULL && vma->start < end;
+					vma = vma_next (&spt->vmas, vma->end))
+				vma->advice = advice;
+			return true;
+		case MADV_WILLNEED:
+			for (struct vma *vma = vma_next (&spt->vmas, start);
+					vma != NULL && vma->start < end;
+					vma = vma_next (&spt->vmas, vma->end))
+				if (vma->file != NULL)
+					vm_willneed (spt, vma, MAX (start, vma->start), MIN (end, vma->end));
+			return true;
+		case MADV_DONTNEED:
+			vm_dontneed (spt, start, end);
+			return true;
+		default:
+			return false;
+	}
 }
 
 /* Free the page.
@@ -271,29 +978,138 @@ vm_claim_page (void *va UNUSED) {
 	return vm_do_claim_page (page);
 }
 
-/* Claim the PAGE and set up the mmu. */
+/* Claim the PAGE and set up the mmu. PAGE stays locked meanwhile, so
+ * that a concurrent fault on it waits for this one instead of racing
+ * with it, and finds it present. */
 static bool
 vm_do_claim_page(struct page *page)
 {
-	struct thread *curr = thread_current ();
+	bool success;
+
+	ASSERT (page != NULL);
+	vm_lock_page (page);
+	if (page->frame != NULL)
+		success = true;
+	else if (page_is_shareable (page))
+		success = vm_claim_shared (page, true);
+	else if (shmem_is_page (page))
+		success = vm_claim_shmem (page);
+	else
+		success = vm_map_frame (page, vm_get_frame ());
+	vm_unlock_page (page);
+	return success;
+}
+
+/* Maps PAGE, a page of shared memory, to the frame of its page of the
+ * object, bringing that in first if no other process has. */
+static bool
+vm_claim_shmem (struct page *page) {
+	void *kva = NULL;
+
+	if (shmem_map_page (page, &kva))
+		return true;
 	struct frame *frame = vm_get_frame ();
+	kva = frame->kva;
+	free (frame);
+	bool success = shmem_map_page (page, &kva);
+	if (kva != NULL)
+		palloc_free_page (kva);
+	return success;
+}
+
+/* Returns true if PAGE is a not present page of a read-only ELF
+ * segment, which every process running the binary can share: either
+ * never loaded, or text whose frame was reclaimed. */
+static bool
+page_is_shareable (struct page *page) {
+	if (fcache_is_text (page))
+		return page->frame == NULL;
+	return page->operations->type == VM_UNINIT
+		&& page->uninit.init == lazy_load_segment && !page->writable;
+}
+
+/* Maps PAGE, a shareable ELF page, to the cached frame holding its file
+ * contents, reading them into a new frame first on a miss. The new frame
+ * may come from eviction only if EVICT is true. */
+static bool
+vm_claim_shared (struct page *page, bool evict) {
+	struct vma *vma = fcache_is_text (page) ? page->text.vma
+		: page->uninit.aux;
+	struct inode *inode = file_get_inode (vma->file);
+	off_t ofs = vma_page_offset (vma, page->va);
+	size_t read_bytes = vma_page_read_bytes (vma, page->va);
+	struct fcache_entry *entry;
+
+	entry = fcache_lookup (inode, ofs, read_bytes);
+	if (entry == NULL) {
+		struct frame *frame = evict ? vm_get_frame () : vm_try_get_frame ();
+		if (frame == NULL)
+			return false;
+		if (file_read_at (vma->file, frame->kva, read_bytes, ofs)
+				!= (int) read_bytes) {
+			palloc_free_page (frame->kva);
+			free (frame);
+			return false;
+		}
+		thread_current ()->rusage.inblock++;
+		memset (frame->kva + read_bytes, 0, PGSIZE - read_bytes);
+
+		entry = fcache_insert (inode, ofs, read_bytes, frame->kva);
+		if (entry == NULL || fcache_kva (entry) != frame->kva)
+			palloc_free_page (frame->kva);
+		free (frame);
+		if (entry == NULL)
+			return false;
+	}
+
+	return fcache_map_page (page, entry, vma);
+}
+
+/* Links PAGE with FRAME, maps it in the current process and reads in its
+ * contents. If PAGE cannot be mapped or its contents cannot be read, it
+ * is left without a frame and FRAME is freed. PAGE must be locked. */
+static bool
+vm_map_frame (struct page *page, struct frame *frame)
+{
+	struct thread *curr = thread_current ();
 	/* Set links */
 	ASSERT (frame != NULL);
 	ASSERT (page != NULL);
+
+	/* Map first, so that a failure leaves nothing on the clock. */
+	if (!pml4_set_page (curr -> pml4, page -> va, frame->kva, page -> writable)) {
+		palloc_free_page (frame->kva);
+		free (frame);
+		return false;
+	}
 	frame->page = page;
+	frame->owner = curr;
 	page->frame = frame;
 
 	// Add to frame_list for eviction clock algorithm
+	lock_acquire (&clock_lock);
 	if (clock_elem != NULL)
 		// Just before current clock
 		list_insert (clock_elem, &frame->frame_elem);
 	else
 		list_push_back (&frame_list, &frame->frame_elem);
+	if (curr->clock_hand != NULL)
+		list_insert (curr->clock_hand, &frame->owner_elem);
+	else
+		list_push_back (&curr->frames, &frame->owner_elem);
+	curr->frame_cnt++;
+	lock_release (&clock_lock);
 
-	/* Insert page table entry to map page's VA to frame's PA. */
-	if (!pml4_set_page (curr -> pml4, page -> va, frame->kva, page -> writable))
-		return false;
-	return swap_in (page, frame->kva);
+	if (swap_in (page, frame->kva))
+		return true;
+
+	/* Undo all of the above. The page is locked, so neither the clock
+	 * nor the flusher has taken the frame meanwhile. */
+	pml4_clear_page (curr->pml4, page->va);
+	page->frame = NULL;
+	palloc_free_page (frame->kva);
+	vm_remove_frame (frame);
+	return false;
 }
 
 
@@ -303,6 +1119,11 @@ supplemental_page_table_init (struct supplemental_page_table *spt UNUSED) {
     struct hash* page_table = malloc(sizeof (struct hash));
 	hash_init (page_table, page_hash, page_less, NULL);
 	spt -> pages = page_table;
+	vma_table_init (&spt->vmas);
+	rwlock_init (&spt->lock);
+	spt -> fa_next = NULL;
+	spt -> fa_window = 0;
+	spt -> fa_streak = 0;
 }
 
 /* Copy supplemental page table from src to dst */
@@ -310,6 +1131,11 @@ supplemental_page_table_init (struct supplemental_page_table *spt UNUSED) {
 bool
 supplemental_page_table_copy (struct supplemental_page_table *dst,
 		struct supplemental_page_table *src) {
+	/* Segment and shared pages not copied below come back from the areas
+	 * on fault. */
+	if (!vma_table_copy (&dst->vmas, &src->vmas, VMA_SEGMENT | VMA_SHARED))
+		return false;
+
 	/*Iterate Source spt hash table*/
 	struct hash_iterator i;
 	hash_first (&i, src -> pages);
@@ -321,13 +1147,14 @@ supplemental_page_table_copy (struct supplemental_page_table *dst,
 			vm_initializer* init = page ->uninit.init;
 			bool writable = page -> writable;
 			int type = page ->uninit.type;
-			if (type & VM_ANON){
-				struct load_info* li = malloc (sizeof (struct load_info));
-				li -> file = file_duplicate (((struct load_info *) page -> uninit .aux)->file);
-				li -> page_read_bytes = ((struct load_info *) page -> uninit .aux)->page_read_bytes;
-				li -> page_zero_bytes = ((struct load_info *) page -> uninit .aux)->page_zero_bytes;
-				li -> ofs = ((struct load_info *) page -> uninit .aux)->ofs;
-				vm_alloc_page_with_initializer (type, page -> va, writable, init, (void*) li);
+			if (init == lazy_load_segment){
+				//Do nothing(the child's area loads it)
+			}
+			else if (type & VM_ANON){
+				/* Demand-zero pages keep their initializer. */
+				if (!vm_alloc_page_with_initializer (type, page -> va, writable,
+							init, NULL))
+					return false;
 			}
 			else if (type & VM_FILE){
 				//Do_nothing(it should not inherit mmap)
@@ -335,6 +1162,23 @@ supplemental_page_table_copy (struct supplemental_page_table *dst,
 
 		}
 		
+		/* Shared memory comes back from its area, like segments. */
+		else if (shmem_is_page (page)){
+			//Do nothing(the child's area maps it)
+		}
+
+		/* Read-only text keeps sharing the cached frame, if it still has
+		 * one; otherwise the child's page loads it like a fresh one. */
+		else if (fcache_is_text (page)){
+			struct vma *vma = vma_find (&dst -> vmas, page -> va);
+			if (!vm_alloc_page_with_initializer (VM_ANON, page -> va, false,
+						lazy_load_segment, vma))
+				return false;
+			struct page* new_page = spt_find_page (&thread_current () -> spt, page -> va);
+			if (!fcache_share_page (new_page, page, vma))
+				return false;
+		}
+
 		/* Handle ANON/FILE page*/
 		else if (page_get_type(page) == VM_ANON){
 			if (!vm_alloc_page (page -> operations -> type, page -> va, page -> writable))
@@ -356,6 +1200,7 @@ static void
 spt_destroy (struct hash_elem *e, void *aux UNUSED){
 	struct page *page = hash_entry (e, struct page, hash_elem);
 	ASSERT (page != NULL);
+	vm_lock_page (page);
 	destroy (page);
 	free (page);
 }
@@ -385,10 +1230,12 @@ supplemental_page_table_kill (struct supplemental_page_table *spt UNUSED) {
 
 //스탐
   if (spt -> pages == NULL) return;
-	lock_acquire(&spt_kill_lock);
+	rwlock_acquire_write (&spt->lock);
+	do_munmap_all ();
 	hash_destroy (spt -> pages, spt_destroy);
 	free (spt -> pages);
-	lock_release(&spt_kill_lock);
+	vma_table_destroy (&spt->vmas);
+	rwlock_release_write (&spt->lock);
 }
 
 // 보류
@@ -0,0 +1,267 @@
+/* vma.c: Virtual memory areas of a process.
+ *
+ * Each ELF segment and each mmap() is recorded as one area, so mapping
+ * it costs one allocation no matter how large it is. The struct page of a
+ * page inside an area is created by vma_alloc_page() when the page is
+ * first faulted on or looked up. Areas are kept in an array sorted by
+ * address and searched with binary search. */
+
+#include "vm/vma.h"
+#include <round.h>
+#include <string.h>
+#include "filesys/file.h"
+#include "threads/malloc.h"
+#include "threads/vaddr.h"
+#include "userprog/process.h"
+#include "vm/vm.h"
+#include "vm/file.h"
+
+void
+vma_table_init (struct vma_table *vmas) {
+	vmas->areas = NULL;
+	vmas->cnt = 0;
+	vmas->cap = 0;
+}
+
+/* Frees every area of VMAS and leaves it empty. */
+void
+vma_table_destroy (struct vma_table *vmas) {
+	for (size_t i = 0; i < vmas->cnt; i++) {
+		file_close (vmas->areas[i]->file);
+		shmem_put (vmas->areas[i]->shm);
+		free (vmas->areas[i]);
+	}
+	free (vmas->areas);
+	vma_table_init (vmas);
+}
+
+/* Copies the areas of SRC whose kind is in FLAGS into DST. */
+bool
+vma_table_copy (struct vma_table *dst, const struct vma_table *src,
+		int flags) {
+	for (size_t i = 0; i < src->cnt; i++) {
+		struct vma *vma = src->areas[i];
+		if ((vma->flags & flags) == 0)
+			continue;
+		struct vma *copy = vma_create (dst, vma->start, vma->end - vma->start,
+				vma->file, vma->offset, vma->read_bytes, vma->writable,
+				vma->flags);
+		if (copy == NULL)
+			return false;
+		copy->shm = shmem_get (vma->shm);
+		copy->advice = vma->advice;
+	}
+	return true;
+}
+
+/* Returns the index of the first area of VMAS that ends above VA. */
+static size_t
+vma_search (const struct vma_table *vmas, const void *va) {
+	size_t lo = 0, hi = vmas->cnt;
+
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+		if (vmas->areas[mid]->end <= va)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+/* Returns the area that contains VA, or NULL. */
+struct vma *
+vma_find (const struct vma_table *vmas, const void *va) {
+	size_t i = vma_search (vmas, va);
+	if (i < vmas->cnt && vmas->areas[i]->start <= va)
+		return vmas->areas[i];
+	return NULL;
+}
+
+/* Returns the first area that ends above VA, or NULL. */
+struct vma *
+vma_next (const struct vma_table *vmas, const void *va) {
+	size_t i = vma_search (vmas, va);
+	return i < vmas->cnt ? vmas->areas[i] : NULL;
+}
+
+/* Returns true if any area intersects [START, END). */
+bool
+vma_overlaps (const struct vma_table *vmas, const void *start,
+		const void *end) {
+	size_t i = vma_search (vmas, start);
+	return i < vmas->cnt && vmas->areas[i]->start < end;
+}
+
+/* Adds VMA to VMAS, unless it overlaps an existing area. */
+static bool
+vma_insert (struct vma_table *vmas, struct vma *vma) {
+	if (vma_overlaps (vmas, vma->start, vma->end))
+		return false;
+
+	if (vmas->cnt == vmas->cap) {
+		size_t cap = vmas->cap != 0 ? vmas->cap * 2 : 8;
+		struct vma **areas = realloc (vmas->areas, cap * sizeof *areas);
+		if (areas == NULL)
+			return false;
+		vmas->areas = areas;
+		vmas->cap = cap;
+	}
+
+	size_t i = vma_search (vmas, vma->start);
+	memmove (&vmas->areas[i + 1], &vmas->areas[i],
+			(vmas->cnt - i) * sizeof *vmas->areas);
+	vmas->areas[i] = vma;
+	vmas->cnt++;
+	return true;
+}
+
+/* Maps LENGTH bytes at START, a page boundary, to FILE from OFFSET on.
+ * The first READ_BYTES bytes come from the file and the rest of the last
+ * page is zero. The area reads through its own handle to FILE, which is
+ * NULL for shared memory. Returns the new area, or NULL if it would
+ * overlap another one or memory is short. */
+struct vma *
+vma_create (struct vma_table *vmas, void *start, size_t length,
+		struct file *file, off_t offset, size_t read_bytes, bool writable,
+		int flags) {
+	ASSERT (pg_ofs (start) == 0);
+
+	struct vma *vma = malloc (sizeof *vma);
+	if (vma == NULL)
+		return NULL;
+	vma->start = start;
+	vma->end = start + ROUND_UP (length, PGSIZE);
+	vma->file = file != NULL ? file_reopen (file) : NULL;
+	vma->shm = NULL;
+	vma->offset = offset;
+	vma->read_bytes = read_bytes;
+	vma->writable = writable;
+	vma->flags = flags;
+	vma->advice = MADV_NORMAL;
+
+	if ((file != NULL && vma->file == NULL) || !vma_insert (vmas, vma)) {
+		file_close (vma->file);
+		free (vma);
+		return NULL;
+	}
+	return vma;
+}
+
+/* Removes VMA from VMAS and frees it. Pages created from it must have
+ * been removed already. */
+void
+vma_destroy (struct vma_table *vmas, struct vma *vma) {
+	size_t i = vma_search (vmas, vma->start);
+
+	ASSERT (i < vmas->cnt && vmas->areas[i] == vma);
+	memmove (&vmas->areas[i], &vmas->areas[i + 1],
+			(vmas->cnt - i - 1) * sizeof *vmas->areas);
+	vmas->cnt--;
+	file_close (vma->file);
+	shmem_put (vma->shm);
+	free (vma);
+}
+
+/* Narrows VMA down to [START, END), a page-aligned part of it. Pages
+ * outside the new bounds must have been removed already. */
+void
+vma_shrink (struct vma *vma, void *start, void *end) {
+	size_t skip = start - vma->start;
+
+	ASSERT (pg_ofs (start) == 0 && pg_ofs (end) == 0);
+	ASSERT (vma->start <= start && start < end && end <= vma->end);
+	vma->offset += skip;
+	vma->read_bytes = vma->read_bytes > skip ? vma->read_bytes - skip : 0;
+	vma->read_bytes = MIN (vma->read_bytes, (size_t) (end - start));
+	vma->start = start;
+	vma->end = end;
+}
+
+/* Splits VMA at VA, a page boundary strictly inside it. VMA keeps the
+ * lower part and the upper part is returned as a new area with its own
+ * file handle, or NULL if memory is short. Pages already created in the
+ * upper part still refer to VMA's file and must be moved over by the
+ * caller. */
+struct vma *
+vma_split (struct vma_table *vmas, struct vma *vma, void *va) {
+	ASSERT (pg_ofs (va) == 0);
+	ASSERT (vma->start < va && va < vma->end);
+
+	struct vma *upper = malloc (sizeof *upper);
+	if (upper == NULL)
+		return NULL;
+	*upper = *vma;
+	if (vma->file != NULL) {
+		upper->file = file_reopen (vma->file);
+		if (upper->file == NULL) {
+			free (upper);
+			return NULL;
+		}
+	}
+	shmem_get (upper->shm);
+	vma_shrink (upper, va, vma->end);
+
+	void *end = vma->end;
+	size_t read_bytes = vma->read_bytes;
+	vma_shrink (vma, vma->start, va);
+	if (!vma_insert (vmas, upper)) {
+		vma->end = end;
+		vma->read_bytes = read_bytes;
+		file_close (upper->file);
+		shmem_put (upper->shm);
+		free (upper);
+		return NULL;
+	}
+	return upper;
+}
+
+/* Returns the file offset of page VA of VMA. */
+off_t
+vma_page_offset (const struct vma *vma, const void *va) {
+	return vma->offset + (va - vma->start);
+}
+
+/* Returns how many bytes of page VA of VMA come from the file. */
+size_t
+vma_page_read_bytes (const struct vma *vma, const void *va) {
+	size_t ofs = va - vma->start;
+	return vma->read_bytes > ofs ? MIN (vma->read_bytes - ofs, PGSIZE) : 0;
+}
+
+/* Creates the page of VMA at VA in the current process's supplemental
+ * page table, ready to be loaded lazily. */
+bool
+vma_alloc_page (struct vma *vma, void *va) {
+	off_t ofs = vma_page_offset (vma, va);
+	size_t read_bytes = vma_page_read_bytes (vma, va);
+
+	ASSERT (pg_ofs (va) == 0);
+	ASSERT (va >= vma->start && va < vma->end);
+
+	if (vma->flags & VMA_SHARED)
+		return shmem_alloc_page (vma->shm, va, ofs / PGSIZE, vma->writable);
+	if (vma->flags & VMA_MMAP) {
+		struct mmap_info *mi = malloc (sizeof *mi);
+		if (mi == NULL)
+			return false;
+		mi->file = vma->file;
+		mi->offset = ofs;
+		mi->read_bytes = read_bytes;
+		if (!vm_alloc_page_with_initializer (VM_FILE, va, vma->writable,
+					lazy_load_file, mi)) {
+			free (mi);
+			return false;
+		}
+		return true;
+	}
+
+	/* Segment pages share the area as their descriptor; it outlives
+	 * them. Pages past the file data never touch the file. */
+	if (read_bytes == 0)
+		return vm_alloc_page_with_initializer (VM_ANON, va, vma->writable,
+				vm_zero_page, NULL);
+	return vm_alloc_page_with_initializer (VM_ANON, va, vma->writable,
+			lazy_load_segment, vma);
+}
+